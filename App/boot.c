@@ -0,0 +1,120 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static bool claim_report(void);
+
+
+/*
+ * GLOBALS
+ */
+// Milestone times, by HAL tick (ms since `HAL_Init()`) and by wall clock
+static volatile uint32_t milestone_ticks[BOOT_MILESTONE_COUNT] = { 0 };
+static volatile uint64_t milestone_wall_us[BOOT_MILESTONE_COUNT] = { 0 };
+static volatile uint32_t milestones_reached = 0;
+static volatile bool     is_reported = false;
+
+
+/**
+ * @brief Record that boot has reached a milestone.
+ *
+ * Only the first mark of each milestone counts, so it is safe to mark
+ * milestones from code that runs repeatedly. The boot times are logged
+ * once the first forecast has been received, by which time logging is
+ * certainly available, or by `boot_check_report()` if that takes too long.
+ *
+ * @param milestone: The milestone reached, eg. `BOOT_MILESTONE_NETWORK_UP`.
+ */
+void boot_mark(uint32_t milestone) {
+
+    if (milestone >= BOOT_MILESTONE_COUNT) return;
+
+    // Read the wall clock outside the critical section: it's a system call
+    uint64_t wall_us = 0;
+    mvGetWallTime(&wall_us);
+
+    // Milestones are marked from more than one task
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool is_first = (milestones_reached & (1UL << milestone)) == 0;
+    if (is_first) {
+        milestone_ticks[milestone] = HAL_GetTick();
+        milestone_wall_us[milestone] = wall_us;
+        milestones_reached |= (1UL << milestone);
+    }
+    __set_PRIMASK(primask);
+
+    if (is_first && milestone == BOOT_MILESTONE_FIRST_FORECAST && claim_report()) boot_report();
+}
+
+
+/**
+ * @brief Log the boot times if no forecast has arrived in time.
+ *
+ * Call this periodically. Without it, a device that never gets a
+ * forecast would never report how far it got. Milestones not reached
+ * by then are logged as -1.
+ *
+ * @param tick: The current HAL tick.
+ */
+void boot_check_report(uint32_t tick) {
+
+    if (is_reported || tick < BOOT_REPORT_TIMEOUT_MS) return;
+    if (claim_report()) boot_report();
+}
+
+
+/**
+ * @brief Log the time taken to reach each boot milestone as a single record.
+ *
+ * Each milestone shows two values: the HAL tick and the wall clock time
+ * elapsed since `HAL_Init()`, in ms. Both are -1 for milestones not
+ * yet reached, as `hal` is always 0. `tools/boot_times.py` summarises these records.
+ */
+void boot_report(void) {
+
+    int32_t ticks[BOOT_MILESTONE_COUNT];
+    int32_t walls[BOOT_MILESTONE_COUNT];
+    uint64_t wall_base = milestone_wall_us[BOOT_MILESTONE_HAL_INIT];
+    for (uint32_t i = 0 ; i < BOOT_MILESTONE_COUNT ; ++i) {
+        ticks[i] = -1;
+        walls[i] = -1;
+        if ((milestones_reached & (1UL << i)) == 0) continue;
+        ticks[i] = (int32_t)milestone_ticks[i];
+        walls[i] = milestone_wall_us[i] > wall_base ? (int32_t)((milestone_wall_us[i] - wall_base) / 1000) : 0;
+    }
+
+    // One format string, not a loop, so that binary logging keeps every value
+    LOG_INFO("Boot at %lu: hal %ld/%ld info %ld/%ld nc %ld/%ld kernel %ld/%ld i2c %ld/%ld ht16k33 %ld/%ld glyphs %ld/%ld pixel %ld/%ld network %ld/%ld config %ld/%ld forecast %ld/%ld",
+             (uint32_t)(wall_base / 1000000),
+             ticks[0], walls[0], ticks[1], walls[1], ticks[2], walls[2], ticks[3], walls[3],
+             ticks[4], walls[4], ticks[5], walls[5], ticks[6], walls[6], ticks[7], walls[7],
+             ticks[8], walls[8], ticks[9], walls[9], ticks[10], walls[10]);
+}
+
+
+/**
+ * @brief Take the right to log the boot times, which are logged only once
+ *        so that `tools/boot_times.py` sees one record per boot.
+ *
+ * @returns `true` if the caller should log them, otherwise `false`.
+ */
+static bool claim_report(void) {
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool is_claimed = !is_reported;
+    is_reported = true;
+    __set_PRIMASK(primask);
+    return is_claimed;
+}
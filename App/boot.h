@@ -0,0 +1,54 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Boot milestones, in their usual order. The network and display come
+// up in separate tasks, so those after kernel start may be reached in
+// any order
+#define     BOOT_MILESTONE_HAL_INIT             0
+#define     BOOT_MILESTONE_DEVICE_INFO          1   // `log_device_info()`
+#define     BOOT_MILESTONE_NC_SETUP             2   // Shared notification center
+#define     BOOT_MILESTONE_KERNEL_START         3
+#define     BOOT_MILESTONE_I2C_INIT             4
+#define     BOOT_MILESTONE_DISPLAY_INIT         5   // `HT16K33_init()`
+#define     BOOT_MILESTONE_GLYPHS               6   // Weather icons defined
+#define     BOOT_MILESTONE_FIRST_PIXEL          7
+#define     BOOT_MILESTONE_NETWORK_UP           8
+#define     BOOT_MILESTONE_FIRST_CONFIG         9   // First config fetch response
+#define     BOOT_MILESTONE_FIRST_FORECAST       10
+#define     BOOT_MILESTONE_COUNT                11
+
+// Log the boot times after this long, even without a forecast
+#define     BOOT_REPORT_TIMEOUT_MS              60000
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        boot_mark(uint32_t milestone);
+void        boot_report(void);
+void        boot_check_report(uint32_t tick);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _BOOT_H_
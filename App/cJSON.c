@@ -185,6 +185,9 @@ static void * CJSON_CDECL internal_realloc(void *pointer, size_t size)
 
 static internal_hooks global_hooks = { internal_malloc, internal_free, internal_realloc };
 
+static void* cast_away_const(const void* string);
+static void free_object_index(cJSON * const object);
+
 static unsigned char* cJSON_strdup(const unsigned char* string, const internal_hooks * const hooks)
 {
     size_t length = 0;
@@ -268,6 +271,7 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
         {
             global_hooks.deallocate(item->string);
         }
+        free_object_index(item);
         global_hooks.deallocate(item);
         item = next;
     }
@@ -1877,21 +1881,128 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
     return get_array_item(array, (size_t)index);
 }
 
+/* Open-addressed hash of an object's keys to its members, at most half full.
+ * Keys are hashed in lower case so that case insensitive lookups can use it too.
+ * Members are inserted in list order, so along any probe sequence a duplicate
+ * key comes after the first, and lookups find what walking the list would. */
+typedef struct cJSON_Index
+{
+    size_t mask;
+    cJSON *slots[1];
+} cJSON_Index;
+
+static void free_object_index(cJSON * const object)
+{
+#if CJSON_INDEX_THRESHOLD > 0
+    if ((object != NULL) && (object->index != NULL))
+    {
+        global_hooks.deallocate(object->index);
+        object->index = NULL;
+    }
+#else
+    (void)object;
+#endif
+}
+
+#if CJSON_INDEX_THRESHOLD > 0
+static size_t index_hash(const unsigned char *key)
+{
+    /* FNV-1a */
+    size_t hash = 2166136261U;
+    for (; *key != '\0'; key++)
+    {
+        hash = (hash ^ (size_t)tolower(*key)) * 16777619U;
+    }
+
+    return hash;
+}
+
+static cJSON_Index *build_object_index(const cJSON * const object)
+{
+    cJSON_Index *index = NULL;
+    cJSON *child = NULL;
+    size_t count = 0;
+    size_t capacity = 4;
+    size_t slot = 0;
+
+    for (child = object->child; child != NULL; child = child->next)
+    {
+        /* the list walk stops at a member without a key, so don't index past one */
+        if (child->string == NULL)
+        {
+            return NULL;
+        }
+        count++;
+    }
+
+    while (capacity < count * 2)
+    {
+        capacity <<= 1;
+    }
+
+    index = (cJSON_Index*)global_hooks.allocate(sizeof(cJSON_Index) + (capacity - 1) * sizeof(cJSON*));
+    if (index == NULL)
+    {
+        return NULL;
+    }
+
+    memset(index->slots, '\0', capacity * sizeof(cJSON*));
+    index->mask = capacity - 1;
+    for (child = object->child; child != NULL; child = child->next)
+    {
+        slot = index_hash((const unsigned char*)child->string) & index->mask;
+        while (index->slots[slot] != NULL)
+        {
+            slot = (slot + 1) & index->mask;
+        }
+        index->slots[slot] = child;
+    }
+
+    return index;
+}
+
+static cJSON *find_in_object_index(const cJSON_Index * const index, const char * const name, const cJSON_bool case_sensitive)
+{
+    size_t slot = index_hash((const unsigned char*)name) & index->mask;
+    cJSON *candidate = NULL;
+
+    while ((candidate = index->slots[slot]) != NULL)
+    {
+        if (case_sensitive ? (strcmp(name, candidate->string) == 0) : (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)candidate->string) == 0))
+        {
+            return candidate;
+        }
+        slot = (slot + 1) & index->mask;
+    }
+
+    return NULL;
+}
+#endif
+
 static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
 {
     cJSON *current_element = NULL;
+    size_t walked = 0;
 
     if ((object == NULL) || (name == NULL))
     {
         return NULL;
     }
 
+#if CJSON_INDEX_THRESHOLD > 0
+    if (object->index != NULL)
+    {
+        return find_in_object_index(object->index, name, case_sensitive);
+    }
+#endif
+
     current_element = object->child;
     if (case_sensitive)
     {
         while ((current_element != NULL) && (current_element->string != NULL) && (strcmp(name, current_element->string) != 0))
         {
             current_element = current_element->next;
+            walked++;
         }
     }
     else
@@ -1899,9 +2010,21 @@ static cJSON *get_object_item(const cJSON * const object, const char * const nam
         while ((current_element != NULL) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
         {
             current_element = current_element->next;
+            walked++;
         }
     }
 
+#if CJSON_INDEX_THRESHOLD > 0
+    /* References share their members' list, so can't see it change: don't index them */
+    if ((walked >= CJSON_INDEX_THRESHOLD) && cJSON_IsObject(object) && !(object->type & cJSON_IsReference))
+    {
+        /* the index is only a cache, so building it doesn't change the object */
+        ((cJSON*)cast_away_const(object))->index = build_object_index(object);
+    }
+#else
+    (void)walked;
+#endif
+
     if ((current_element == NULL) || (current_element->string == NULL)) {
         return NULL;
     }
@@ -1948,6 +2071,9 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
 
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
+#if CJSON_INDEX_THRESHOLD > 0
+    reference->index = NULL;
+#endif
     reference->type |= cJSON_IsReference;
     reference->next = reference->prev = NULL;
     return reference;
@@ -1962,6 +2088,7 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
         return false;
     }
 
+    free_object_index(array);
     child = array->child;
     /*
      * To find the last item in array quickly, we use prev in array
@@ -2191,6 +2318,8 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
         return NULL;
     }
 
+    free_object_index(parent);
+
     if (item != parent->child)
     {
         /* not the first element */
@@ -2275,6 +2404,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON
         return add_item_to_array(array, newitem);
     }
 
+    free_object_index(array);
     newitem->next = after_inserted;
     newitem->prev = after_inserted->prev;
     after_inserted->prev = newitem;
@@ -2301,6 +2431,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         return true;
     }
 
+    free_object_index(parent);
     replacement->next = item->next;
     replacement->prev = item->prev;
 
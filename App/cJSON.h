@@ -99,6 +99,21 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
 
+/* An object lookup that has to walk past this many members builds a hashed index of the
+ * object's keys, so later lookups are O(1). The index is freed when the object is changed
+ * through the cJSON API. Changing an item's string directly leaves a stale index.
+ * Set to 0 to disable the index. The application parses with App/json.c, so the index
+ * is only compiled in for the JSON benchmark. */
+#ifndef CJSON_INDEX_THRESHOLD
+/* The build flag is `true` or `false`: without stdbool.h, both would read as 0 in cJSON.c */
+#include <stdbool.h>
+#if ENABLE_JSON_BENCHMARK == true
+#define CJSON_INDEX_THRESHOLD 16
+#else
+#define CJSON_INDEX_THRESHOLD 0
+#endif
+#endif
+
 /* The cJSON structure: */
 typedef struct cJSON
 {
@@ -120,6 +135,11 @@ typedef struct cJSON
 
     /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
     char *string;
+
+#if CJSON_INDEX_THRESHOLD > 0
+    /* An object's hashed key index, built on demand. Internal: see CJSON_INDEX_THRESHOLD */
+    struct cJSON_Index *index;
+#endif
 } cJSON;
 
 typedef struct cJSON_Hooks
@@ -9,6 +9,12 @@
 #include "main.h"
 
 
+/*
+ * STATIC PROTOTYPES
+ */
+static bool config_fetch(ConfigItem items[], uint32_t item_count, uint32_t scope, uint32_t store);
+
+
 /*
  * GLOBALS
  */
@@ -22,11 +28,56 @@ static struct {
 
 volatile bool received_config = false;
 
+// Per-device items fetched by `config_preload()`, and their keys
+// where these are not constants
+static ConfigItem preloaded_items[CONFIG_PRELOAD_MAX];
+static uint32_t   preloaded_count = 0;
+static char       location_keys[LOCATION_MAX][16];
+
+
+/**
+ * @brief Fetch every per-device config item the application reads
+ *        in a single request.
+ *
+ * `config_get_value()` then answers from these values, rather than
+ * making a request for each item. If the request fails, the items
+ * are treated as not set, so their defaults apply.
+ *
+ * @returns `true` if the items were fetched successfully,
+ *          otherwise `false`
+ */
+bool config_preload(void) {
+
+    static const char* keys[] = {
+        LOG_LEVEL_CONFIG_KEY,
+        LOG_RATE_CONFIG_KEY,
+        POLL_CONFIG_KEY,
+        TELEMETRY_URL_CONFIG_KEY,
+        TELEMETRY_PERIOD_CONFIG_KEY
+    };
+
+    uint32_t count = 0;
+    memset(preloaded_items, 0x00, sizeof(preloaded_items));
+    for (uint32_t i = 0 ; i < sizeof(keys) / sizeof(keys[0]) ; ++i) {
+        preloaded_items[count++].key = keys[i];
+    }
+
+    for (uint32_t i = 0 ; i < LOCATION_MAX ; ++i) {
+        sprintf(location_keys[i], "%s%lu", LOCATION_CONFIG_KEY_PREFIX, i + 1);
+        preloaded_items[count++].key = location_keys[i];
+    }
+
+    bool success = config_fetch(preloaded_items, count, MV_CONFIGKEYFETCHSCOPE_DEVICE, MV_CONFIGKEYFETCHSTORE_CONFIG);
+    preloaded_count = count;
+    return success;
+}
+
 
 /**
  * @brief Request the value of a secret.
  *
  * @param value_buffer - Whether the value will be written back to.
+ *                       Must hold at least `CONFIG_VALUE_LEN_B` bytes.
  * @param key          - The key name we're targeting.
  *
  * @returns `true` if the value was retrieved successfully,
@@ -34,6 +85,65 @@ volatile bool received_config = false;
  */
 bool config_get_secret(char *value_buffer, char key[]) {
 
+    ConfigItem item = { .key = key };
+    if (!config_fetch(&item, 1, MV_CONFIGKEYFETCHSCOPE_ACCOUNT, MV_CONFIGKEYFETCHSTORE_SECRET) || !item.is_found) return false;
+    strcpy(value_buffer, item.value);
+    return true;
+}
+
+
+/**
+ * @brief Request the value of a per-device config item.
+ *
+ * Items fetched by `config_preload()` are not requested again.
+ *
+ * @param value_buffer - Whether the value will be written back to.
+ *                       Must hold at least `CONFIG_VALUE_LEN_B` bytes.
+ * @param key          - The key name we're targeting.
+ *
+ * @returns `true` if the value was retrieved successfully,
+ *          `false` if it is not set or could not be retrieved
+ */
+bool config_get_value(char *value_buffer, char key[]) {
+
+    for (uint32_t i = 0 ; i < preloaded_count ; ++i) {
+        if (strcmp(preloaded_items[i].key, key) == 0) {
+            if (!preloaded_items[i].is_found) return false;
+            strcpy(value_buffer, preloaded_items[i].value);
+            return true;
+        }
+    }
+
+    ConfigItem item = { .key = key };
+    if (!config_fetch(&item, 1, MV_CONFIGKEYFETCHSCOPE_DEVICE, MV_CONFIGKEYFETCHSTORE_CONFIG) || !item.is_found) return false;
+    strcpy(value_buffer, item.value);
+    return true;
+}
+
+
+/**
+ * @brief Request the values of config store items in a single request.
+ *
+ * Items that are not set are not an error: they are just marked
+ * as not found, so that the caller can apply its default.
+ *
+ * @param items        - The items to fetch. Each item's `key` must be set.
+ * @param item_count   - The number of items, at most `CONFIG_PRELOAD_MAX`.
+ * @param scope        - The items' scope, eg. `MV_CONFIGKEYFETCHSCOPE_DEVICE`.
+ * @param store        - The items' store, eg. `MV_CONFIGKEYFETCHSTORE_SECRET`.
+ *
+ * @returns `true` if the request succeeded, whether or not the items
+ *          were found, otherwise `false`
+ */
+static bool config_fetch(ConfigItem items[], uint32_t item_count, uint32_t scope, uint32_t store) {
+
+    for (uint32_t i = 0 ; i < item_count ; ++i) {
+        items[i].is_found = false;
+        memset(items[i].value, 0x00, CONFIG_VALUE_LEN_B);
+    }
+
+    if (item_count == 0 || item_count > CONFIG_PRELOAD_MAX) return false;
+
     // Check for a valid channel handle
     if (config_handles.channel == 0) {
         // There's no open channel, so open open one now
@@ -41,26 +151,26 @@ bool config_get_secret(char *value_buffer, char key[]) {
     }
 
     // Set up the request parameters
-    struct MvConfigKeyToFetch key_one = {
-        .scope = MV_CONFIGKEYFETCHSCOPE_ACCOUNT,    // An account-level value
-        .store = MV_CONFIGKEYFETCHSTORE_SECRET,     // A secret value
-        .key = {
-            .data = (uint8_t*)key,
-            .length = strlen(key)
-        }
-    };
-
-    uint32_t item_count = 1;
-    struct MvConfigKeyToFetch keys[item_count];
-    keys[0] = key_one;
+    struct MvConfigKeyToFetch keys[CONFIG_PRELOAD_MAX];
+    for (uint32_t i = 0 ; i < item_count ; ++i) {
+        keys[i].scope = scope;                      // An account- or device-level value
+        keys[i].store = store;                      // A secret or config value
+        keys[i].key.data = (const uint8_t*)items[i].key;
+        keys[i].key.length = strlen(items[i].key);
+    }
 
     struct MvConfigKeyFetchParams request = {
         .num_items = item_count,
         .keys_to_fetch = keys
     };
 
-    // Request the value of the key specified above
-    server_log("Requesting value for key '%s'", key);
+    // Request the values of the keys specified above
+    if (item_count == 1) {
+        server_log("Requesting value for key '%s'", items[0].key);
+    } else {
+        server_log("Requesting values for %lu keys", item_count);
+    }
+
     enum MvStatus status = mvSendConfigFetchRequest(config_handles.channel, &request);
     if (status != MV_STATUS_OKAY) {
         server_error("Could not issue config fetch request");
@@ -83,7 +193,7 @@ bool config_get_secret(char *value_buffer, char key[]) {
     }
 
     // Parse the received data record
-    server_log("Received value for key '%s'", key);
+    boot_mark(BOOT_MILESTONE_FIRST_CONFIG);
     struct MvConfigResponseData response = {
         .result = 0,
         .num_items = 0
@@ -91,35 +201,41 @@ bool config_get_secret(char *value_buffer, char key[]) {
 
     status = mvReadConfigFetchResponseData(config_handles.channel, &response);
     if (status != MV_STATUS_OKAY || response.result != MV_CONFIGFETCHRESULT_OK || response.num_items != item_count) {
-        server_error("Could not get config item (status: %i; result: %i)", status, response.result);
+        server_error("Could not get config items (status: %i; result: %i)", status, response.result);
         config_close_channel();
         return false;
     }
 
-    uint8_t value[65] = {0};
-    uint32_t value_length = 0;
-    enum MvConfigKeyFetchResult result = 0;
-
-    struct MvConfigResponseReadItemParams item = {
-        .result = &result,
-        .item_index = 0,
-        .buf = {
-            .data = &value[0],
-            .size = 64,
-            .length = &value_length
-        }
-    };
+    // Get the values themselves. A key that is not set is the
+    // usual case, not an error
+    uint32_t found_count = 0;
+    for (uint32_t i = 0 ; i < item_count ; ++i) {
+        uint32_t value_length = 0;
+        enum MvConfigKeyFetchResult result = 0;
 
-    // Get the value itself
-    status = mvReadConfigResponseItem(config_handles.channel, &item);
-    if (status != MV_STATUS_OKAY || result != MV_CONFIGKEYFETCHRESULT_OK) {
-        server_error("Could not get config item (status: %i; result: %i)", status, result);
-        config_close_channel();
-        return false;
+        struct MvConfigResponseReadItemParams item = {
+            .result = &result,
+            .item_index = i,
+            .buf = {
+                .data = (uint8_t*)items[i].value,
+                .size = CONFIG_VALUE_LEN_B - 1,
+                .length = &value_length
+            }
+        };
+
+        status = mvReadConfigResponseItem(config_handles.channel, &item);
+        if (status == MV_STATUS_OKAY && result == MV_CONFIGKEYFETCHRESULT_OK) {
+            items[i].is_found = true;
+            found_count++;
+        } else {
+            memset(items[i].value, 0x00, CONFIG_VALUE_LEN_B);
+            if (status != MV_STATUS_OKAY || result != MV_CONFIGKEYFETCHRESULT_KEYNOTFOUND) {
+                server_error("Could not get config item '%s' (status: %i; result: %i)", items[i].key, status, result);
+            }
+        }
     }
 
-    // Copy the value data to the requested location
-    strncpy(value_buffer, (char*)value, value_length + 1);
+    server_log("Received values for %lu of %lu keys", found_count, item_count);
     config_close_channel();
     return true;
 }
@@ -17,6 +17,24 @@
 #define     CONFIG_TX_BUFFER_SIZE_B         512
 #define     CONFIG_WAIT_PERIOD_MS           5000
 
+// Values are read into buffers of this size, including the NUL
+#define     CONFIG_VALUE_LEN_B              65
+
+// The per-device items fetched together by `config_preload()`:
+// five settings and the forecast locations
+#define     CONFIG_PRELOAD_MAX              (5 + LOCATION_MAX)
+
+
+/*
+ * STRUCTURES
+ */
+// A config store item. `is_found` is `false` if the item is not set
+typedef struct {
+    const char* key;
+    char        value[CONFIG_VALUE_LEN_B];
+    bool        is_found;
+} ConfigItem;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,7 +46,9 @@ extern "C" {
  */
 bool        config_open_channel(void);
 void        config_close_channel(void);
+bool        config_preload(void);
 bool        config_get_secret(char *value_buffer, char key[]);
+bool        config_get_value(char *value_buffer, char key[]);
 
 
 #ifdef __cplusplus
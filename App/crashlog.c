@@ -0,0 +1,168 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * GLOBALS
+ */
+// The retained log. The `.noinit` section is not zeroed at startup,
+// so the previous run's content survives a reset. It is only trusted
+// if the header matches this build's layout
+static CrashLog crashlog __attribute__((section(".noinit")));
+
+// The previous run's log, copied out at boot so that this run can
+// start retaining straight away
+static CrashLog previous_run;
+static bool     has_previous_run = false;
+
+static const char* fault_names[] = { "no recorded fault", "assert", "RTOS assert", "hard fault" };
+
+
+/**
+ * @brief Claim the retained log for this run.
+ *
+ * Call first thing in `main()`, before anything is logged.
+ */
+void crashlog_init(void) {
+
+    uint32_t boot_count = 0;
+    if (crashlog.magic == CRASHLOG_MAGIC && crashlog.version == CRASHLOG_VERSION && crashlog.size == sizeof(CrashLog)) {
+        previous_run = crashlog;
+        has_previous_run = true;
+        boot_count = crashlog.boot_count;
+    }
+
+    memset(&crashlog, 0x00, sizeof(CrashLog));
+    crashlog.magic = CRASHLOG_MAGIC;
+    crashlog.version = CRASHLOG_VERSION;
+    crashlog.size = sizeof(CrashLog);
+    crashlog.boot_count = boot_count + 1;
+}
+
+
+/**
+ * @brief Log the previous run's retained messages and fault context.
+ *
+ * Call once the network is up. Does nothing after a cold start.
+ */
+void crashlog_report(void) {
+
+    if (!has_previous_run) return;
+    has_previous_run = false;
+
+    LOG_WARN("Boot %lu: previous run ended after %lu ms with %s",
+             crashlog.boot_count,
+             previous_run.uptime_ms,
+             fault_names[previous_run.fault_type <= CRASHLOG_FAULT_HARD_FAULT ? previous_run.fault_type : CRASHLOG_FAULT_NONE]);
+
+    if (previous_run.fault_type != CRASHLOG_FAULT_NONE) {
+        previous_run.fault_message[CRASHLOG_FAULT_MESSAGE_LEN_B - 1] = 0;
+        LOG_WARN("Fault: %s (0x%08lx)", previous_run.fault_message, previous_run.fault_detail);
+        LOG_WARN("Fault logs: %lu sent, %lu rate limited, %lu repeats dropped",
+                 previous_run.log_stats.sent, previous_run.log_stats.rate_limited, previous_run.log_stats.repeats);
+    }
+
+    // Post the retained messages, oldest first. These are already
+    // formatted, so bypass the rate checks, and aren't retained again
+    uint32_t count = previous_run.write_index < CRASHLOG_RECORD_COUNT ? previous_run.write_index : CRASHLOG_RECORD_COUNT;
+    for (uint32_t i = previous_run.write_index - count ; i != previous_run.write_index ; ++i) {
+        char* record = previous_run.records[i & (CRASHLOG_RECORD_COUNT - 1)];
+        record[CRASHLOG_RECORD_LEN_B - 1] = 0;
+        log_replay(LOG_LEVEL_WARN, record);
+    }
+}
+
+
+/**
+ * @brief Add a formatted log message to the retained ring,
+ *        truncating and marking it if necessary.
+ *
+ * @param message: The message, including its level prefix, or a binary record.
+ */
+void crashlog_add(const char* message) {
+
+    // Work out how much to keep before we block interrupts. A binary
+    // record is cut to whole base64 groups, so what's kept still decodes
+    size_t length = strlen(message);
+    bool is_truncated = length > CRASHLOG_RECORD_LEN_B - 1;
+    if (is_truncated) {
+        length = CRASHLOG_RECORD_LEN_B - sizeof(CRASHLOG_TRUNCATED_MARK);
+        size_t marker_length = sizeof(LOG_BINARY_MARKER) - 1;
+        if (strncmp(message, LOG_BINARY_MARKER, marker_length) == 0) {
+            length = marker_length + (length - marker_length) / 4 * 4;
+        }
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    char* record = crashlog.records[crashlog.write_index & (CRASHLOG_RECORD_COUNT - 1)];
+    memcpy(record, message, length);
+    record[length] = 0;
+    if (is_truncated) strcat(record, CRASHLOG_TRUNCATED_MARK);
+    crashlog.write_index++;
+    crashlog.uptime_ms = HAL_GetTick();
+
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Record why the application is about to halt.
+ *
+ * Safe to call from fault handlers and with interrupts disabled.
+ * Only the first fault of a run is kept.
+ *
+ * @param type:    The fault type, eg. `CRASHLOG_FAULT_ASSERT`.
+ * @param detail:  A type-specific value, eg. a line number.
+ * @param message: A description of the fault.
+ */
+void crashlog_fault(uint32_t type, uint32_t detail, const char* message) {
+
+    if (crashlog.fault_type != CRASHLOG_FAULT_NONE) return;
+
+    crashlog.fault_type = type;
+    crashlog.fault_detail = detail;
+    crashlog.uptime_ms = HAL_GetTick();
+    strncpy(crashlog.fault_message, message, CRASHLOG_FAULT_MESSAGE_LEN_B - 1);
+    log_get_stats(&crashlog.log_stats);
+}
+
+
+/**
+ * @brief Record a failed FreeRTOS assertion.
+ *
+ * Called by `configASSERT()` with interrupts disabled.
+ *
+ * @param file: The source file path.
+ * @param line: The source line.
+ */
+void crashlog_rtos_assert(const char* file, uint32_t line) {
+
+    // Keep the file name, not the build path
+    const char* name = strrchr(file, '/');
+    char message[CRASHLOG_FAULT_MESSAGE_LEN_B] = { 0 };
+    snprintf(message, sizeof(message), "%s:%lu", name != NULL ? name + 1 : file, line);
+    crashlog_fault(CRASHLOG_FAULT_RTOS_ASSERT, line, message);
+}
+
+
+/**
+ * @brief Record a hard fault, then halt.
+ *
+ * The detail value is the Configurable Fault Status Register.
+ */
+void HardFault_Handler(void) {
+
+    crashlog_fault(CRASHLOG_FAULT_HARD_FAULT, SCB->CFSR, "HardFault");
+    while (1) {
+        // NOP
+    }
+}
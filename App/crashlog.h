@@ -0,0 +1,79 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _CRASHLOG_H_
+#define _CRASHLOG_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     CRASHLOG_MAGIC                  0x474C5243      // 'CRLG'
+#define     CRASHLOG_VERSION                1
+#define     CRASHLOG_RECORD_COUNT           16              // Must be a power of two
+#define     CRASHLOG_RECORD_LEN_B           96
+#define     CRASHLOG_FAULT_MESSAGE_LEN_B    64
+
+// Ends a record that was cut to fit. `tools/log_decode.py` looks for
+// it after binary records, which are cut to whole base64 groups
+#define     CRASHLOG_TRUNCATED_MARK         " ..."
+
+// Why the previous run ended
+#define     CRASHLOG_FAULT_NONE             0               // No fault recorded, eg. power loss
+#define     CRASHLOG_FAULT_ASSERT           1               // `do_assert()`
+#define     CRASHLOG_FAULT_RTOS_ASSERT      2               // `configASSERT()`
+#define     CRASHLOG_FAULT_HARD_FAULT       3
+
+// The most verbose level kept in the retained ring. Messages between
+// this and the runtime log level are retained but not posted
+#ifndef     CRASHLOG_LEVEL
+#define     CRASHLOG_LEVEL                  LOG_LEVEL_INFO
+#endif
+
+
+/*
+ * STRUCTURES
+ */
+typedef struct {
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    size;
+    uint32_t    boot_count;
+    uint32_t    write_index;
+    uint32_t    uptime_ms;
+    // Fault context
+    uint32_t    fault_type;
+    uint32_t    fault_detail;
+    char        fault_message[CRASHLOG_FAULT_MESSAGE_LEN_B];
+    LogStats    log_stats;
+    // Recent log messages, oldest overwritten first
+    char        records[CRASHLOG_RECORD_COUNT][CRASHLOG_RECORD_LEN_B];
+} CrashLog;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        crashlog_init(void);
+void        crashlog_report(void);
+void        crashlog_add(const char* message);
+void        crashlog_fault(uint32_t type, uint32_t detail, const char* message);
+void        crashlog_rtos_assert(const char* file, uint32_t line);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _CRASHLOG_H_
@@ -0,0 +1,229 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void diag_timer_callback(void *arg);
+
+
+/*
+ * GLOBALS
+ */
+static osTimerId_t diag_timer = NULL;
+
+// Task snapshots. The previous run-time counters are retained so that
+// each report shows CPU usage over the last period, not since boot
+static TaskStatus_t task_states[DIAG_MAX_TASKS];
+static struct {
+    UBaseType_t number;
+    uint32_t    run_time;
+} last_run_times[DIAG_MAX_TASKS] = { 0 };
+
+// Run-time counter state. CYCCNT is 32 bits and wraps in well under
+// a minute, so we extend it here and hand FreeRTOS a scaled value
+static bool     use_cyccnt = false;
+static uint32_t last_cyccnt = 0;
+static uint64_t total_cycles = 0;
+
+
+/**
+ * @brief Start periodic task diagnostics reporting.
+ *
+ * Call after `osKernelInitialize()` as this creates a CMSIS timer.
+ */
+void diag_init(void) {
+
+    if (TASK_DIAGNOSTICS_PERIOD_S == 0) return;
+
+    diag_timer = osTimerNew(diag_timer_callback, osTimerPeriodic, NULL, NULL);
+    if (diag_timer == NULL || osTimerStart(diag_timer, TASK_DIAGNOSTICS_PERIOD_S * 1000) != osOK) {
+        server_error("Could not start diagnostics timer");
+    }
+}
+
+
+/**
+ * @brief Log a one-line summary of each task's stack headroom
+ *        and CPU usage, plus heap headroom, logging, I2C bus and polling counters.
+ *
+ * Stack high-water marks are in words: the least free stack space
+ * the task has had since it started.
+ */
+void diag_report(void) {
+
+    uint32_t total_run_time = 0;
+    UBaseType_t count = uxTaskGetSystemState(task_states, DIAG_MAX_TASKS, &total_run_time);
+    if (count == 0) {
+        server_error("Too many tasks to report (max. %u)", DIAG_MAX_TASKS);
+        return;
+    }
+
+    // Work out each task's run time over the period just ended
+    uint32_t deltas[DIAG_MAX_TASKS] = { 0 };
+    uint32_t period_run_time = 0;
+    for (UBaseType_t i = 0 ; i < count ; ++i) {
+        uint32_t previous = 0;
+        for (uint32_t j = 0 ; j < DIAG_MAX_TASKS ; ++j) {
+            if (last_run_times[j].number == task_states[i].xTaskNumber) {
+                previous = last_run_times[j].run_time;
+                break;
+            }
+        }
+
+        deltas[i] = task_states[i].ulRunTimeCounter - previous;
+        period_run_time += deltas[i];
+    }
+
+    // Record the counters for next time
+    memset(last_run_times, 0x00, sizeof(last_run_times));
+    for (UBaseType_t i = 0 ; i < count ; ++i) {
+        last_run_times[i].number = task_states[i].xTaskNumber;
+        last_run_times[i].run_time = task_states[i].ulRunTimeCounter;
+    }
+
+    // Assemble the summary: "<name> <cpu>% <hwm>w" per task
+    char summary[256] = { 0 };
+    size_t length = 0;
+    for (UBaseType_t i = 0 ; i < count && length < sizeof(summary) ; ++i) {
+        uint32_t percent = period_run_time > 0 ? (uint32_t)(((uint64_t)deltas[i] * 100) / period_run_time) : 0;
+        length += snprintf(&summary[length], sizeof(summary) - length, "%s%s %lu%% %luw",
+                           (i > 0 ? " | " : ""),
+                           task_states[i].pcTaskName,
+                           percent,
+                           (uint32_t)task_states[i].usStackHighWaterMark);
+    }
+
+    LOG_INFO("Tasks: %s", summary);
+    LOG_INFO("Heap: %u B free (min. %u B)", xPortGetFreeHeapSize(), xPortGetMinimumEverFreeHeapSize());
+
+    LogStats log_stats;
+    log_get_stats(&log_stats);
+    LOG_INFO("Logs: %lu sent, %lu rate limited, %lu repeats dropped", log_stats.sent, log_stats.rate_limited, log_stats.repeats);
+
+    I2CStats i2c_stats;
+    I2C_get_stats(&i2c_stats);
+    uint32_t busy_permille = i2c_stats.period_ms > 0 ? (uint32_t)(((uint64_t)i2c_stats.busy_us * 1000) / ((uint64_t)i2c_stats.period_ms * 1000)) : 0;
+    LOG_INFO("I2C: %lu transfers, %lu errors, %lu coalesced, %lu waits, %lu dropped; bus %lu.%lu%% busy, max. transfer %lu us, max. wait %lu us high, %lu us low",
+             i2c_stats.transfers,
+             i2c_stats.errors,
+             i2c_stats.coalesced,
+             i2c_stats.queue_waits,
+             i2c_stats.dropped,
+             busy_permille / 10,
+             busy_permille % 10,
+             i2c_stats.max_transfer_us,
+             i2c_stats.max_wait_us[I2C_PRIORITY_HIGH],
+             i2c_stats.max_wait_us[I2C_PRIORITY_LOW]);
+
+    static const char* breaker_states[] = { "closed", "open", "half-open" };
+    PollStats poll_stats;
+    poll_get_stats(&poll_stats);
+    LOG_INFO("Polls: %lu ok, failed %lu transient, %lu rate limited, %lu auth, %lu client, %lu offline; breaker %s, %lu trips",
+             poll_stats.successes,
+             poll_stats.failures[POLL_FAILURE_TRANSIENT],
+             poll_stats.failures[POLL_FAILURE_RATE_LIMITED],
+             poll_stats.failures[POLL_FAILURE_AUTH],
+             poll_stats.failures[POLL_FAILURE_CLIENT],
+             poll_stats.failures[POLL_FAILURE_OFFLINE],
+             breaker_states[poll_stats.breaker_state],
+             poll_stats.breaker_trips);
+}
+
+
+/**
+ * @brief Get the least stack headroom of any task.
+ *
+ * Call from the timer task, as `diag_report()` is, since
+ * the two share the task snapshots.
+ *
+ * @returns The smallest stack high-water mark, in words.
+ */
+uint32_t diag_stack_headroom(void) {
+
+    UBaseType_t count = uxTaskGetSystemState(task_states, DIAG_MAX_TASKS, NULL);
+    uint32_t headroom = count > 0 ? UINT32_MAX : 0;
+    for (UBaseType_t i = 0 ; i < count ; ++i) {
+        if (task_states[i].usStackHighWaterMark < headroom) headroom = task_states[i].usStackHighWaterMark;
+    }
+
+    return headroom;
+}
+
+
+/**
+ * @brief Configure the FreeRTOS run-time stats counter source.
+ *
+ * Called by FreeRTOS via `portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()`
+ * when the scheduler starts. We use the DWT cycle counter if
+ * Microvisor lets us enable it, otherwise fall back to the HAL tick.
+ */
+void diag_runtime_counter_init(void) {
+
+    use_cyccnt = diag_cycle_counter_start();
+    last_cyccnt = DWT->CYCCNT;
+    total_cycles = 0;
+}
+
+
+/**
+ * @brief Enable the DWT cycle counter, if it is not already running.
+ *
+ * @returns `true` if the counter is running, otherwise `false`.
+ */
+bool diag_cycle_counter_start(void) {
+
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    // Make sure the counter is actually running
+    uint32_t start = DWT->CYCCNT;
+    for (volatile uint32_t i = 0 ; i < 100 ; ++i) {
+        __asm("nop");
+    }
+
+    return (DWT->CYCCNT != start);
+}
+
+
+/**
+ * @brief Provide the FreeRTOS run-time stats counter.
+ *
+ * Called by FreeRTOS via `portGET_RUN_TIME_COUNTER_VALUE()` on
+ * every context switch.
+ *
+ * @returns The counter value in units of 2^DIAG_RUNTIME_SHIFT cycles,
+ *          or in ms if the cycle counter is not available.
+ */
+uint32_t diag_runtime_counter_value(void) {
+
+    if (!use_cyccnt) return HAL_GetTick();
+
+    uint32_t now = DWT->CYCCNT;
+    total_cycles += (uint32_t)(now - last_cyccnt);
+    last_cyccnt = now;
+    return (uint32_t)(total_cycles >> DIAG_RUNTIME_SHIFT);
+}
+
+
+/**
+ * @brief A CMSIS/FreeRTOS timer callback function.
+ *
+ * @param arg: Pointer to and argument value passed by the timer controller.
+ *             Unused here.
+ */
+static void diag_timer_callback(void *arg) {
+
+    diag_report();
+}
@@ -0,0 +1,47 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _DIAGNOSTICS_H_
+#define _DIAGNOSTICS_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     DIAG_MAX_TASKS                  8
+// Run-time counter units are 2^DIAG_RUNTIME_SHIFT CPU cycles
+#define     DIAG_RUNTIME_SHIFT              10
+
+// Set in the root `CMakeLists.txt`. Zero disables reporting
+#ifndef     TASK_DIAGNOSTICS_PERIOD_S
+#define     TASK_DIAGNOSTICS_PERIOD_S       300
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        diag_init(void);
+void        diag_report(void);
+uint32_t    diag_stack_headroom(void);
+bool        diag_cycle_counter_start(void);
+void        diag_runtime_counter_init(void);
+uint32_t    diag_runtime_counter_value(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _DIAGNOSTICS_H_
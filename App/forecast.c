@@ -0,0 +1,471 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     task_forecast(void *unused_arg);
+static void     forecast_process(const ForecastResponse* response);
+
+
+/*
+ *  GLOBALS
+ */
+// This is the FreeRTOS thread task that parses and classifies
+// forecast responses, so fetching never waits for parsing
+static osThreadId_t thread_forecast;
+static const osThreadAttr_t forecast_task_attributes = {
+    .name = "ForecastTask",
+    .stack_size = 3072,
+    .priority = (osPriority_t)osPriorityBelowNormal
+};
+
+// The pipeline's queues: fetch -> parse and classify, with the
+// first location's forecast also fed back to polling
+static osMessageQueueId_t free_slots = NULL;
+static osMessageQueueId_t responses = NULL;
+static osMessageQueueId_t results = NULL;
+
+// Forecasts are published for display with a sequence lock over two
+// snapshot buffers. The sequence is odd while the inactive buffer is
+// being written and even once it is published. Bit 1 selects the
+// active buffer, which readers copy without locking or blocking
+static ForecastSnapshot     snapshots[2];
+static volatile uint32_t    snapshot_sequence = 0;
+
+// Response bodies, owned by whichever stage holds their slot number
+static char bodies[FORECAST_BODY_SLOTS][FORECAST_BODY_SIZE_B];
+
+// Used by the parse stage, and by the benchmark before the first poll
+static JsonToken tokens[FORECAST_MAX_TOKENS];
+
+
+/**
+ * @brief Create the pipeline's queues and its parse task.
+ *
+ * Call after `osKernelInitialize()`.
+ */
+void forecast_pipeline_init(void) {
+
+    free_slots = osMessageQueueNew(FORECAST_BODY_SLOTS, sizeof(uint8_t), NULL);
+    responses = osMessageQueueNew(FORECAST_BODY_SLOTS, sizeof(ForecastResponse), NULL);
+    results = osMessageQueueNew(FORECAST_RESULT_QUEUE_DEPTH, sizeof(Forecast), NULL);
+    if (free_slots == NULL || responses == NULL || results == NULL) {
+        server_error("Could not create forecast queues");
+        return;
+    }
+
+    for (uint8_t i = 0 ; i < FORECAST_BODY_SLOTS ; ++i) {
+        osMessageQueuePut(free_slots, &i, 0, 0);
+    }
+
+    thread_forecast = osThreadNew(task_forecast, NULL, &forecast_task_attributes);
+    if (thread_forecast == NULL) server_error("Could not start forecast task");
+}
+
+
+/**
+ * @brief Fetch stage: claim a buffer to read a response body into.
+ *
+ * @param slot: Set to the buffer's slot number, to pass to `forecast_submit()`.
+ *
+ * @returns The zeroed buffer, `FORECAST_BODY_SIZE_B` long, or `NULL` if
+ *          every buffer is waiting to be parsed.
+ */
+char* forecast_claim_buffer(uint32_t* slot) {
+
+    uint8_t free_slot = 0;
+    if (free_slots == NULL || osMessageQueueGet(free_slots, &free_slot, NULL, 0) != osOK) return NULL;
+
+    *slot = free_slot;
+    memset(bodies[free_slot], 0x00, FORECAST_BODY_SIZE_B);
+    return bodies[free_slot];
+}
+
+
+/**
+ * @brief Fetch stage: give back a buffer without passing it on,
+ *        eg. because the body could not be read.
+ *
+ * @param slot: The buffer's slot number.
+ */
+void forecast_release_buffer(uint32_t slot) {
+
+    uint8_t free_slot = (uint8_t)slot;
+    osMessageQueuePut(free_slots, &free_slot, 0, 0);
+}
+
+
+/**
+ * @brief Fetch stage: pass a response body on to be parsed.
+ *
+ * The buffer belongs to the parse stage from now on.
+ *
+ * @param slot:       The body's slot number.
+ * @param location:   The location the forecast is for.
+ * @param length:     The body's length.
+ * @param request_ms: The time between sending the request and its response.
+ *
+ * @returns `true` if the body was queued, otherwise `false`.
+ */
+bool forecast_submit(uint32_t slot, uint32_t location, uint32_t length, uint32_t request_ms) {
+
+    ForecastResponse response = {
+        .slot = (uint8_t)slot,
+        .location = (uint8_t)location,
+        .length = (uint16_t)(length < FORECAST_BODY_SIZE_B ? length : FORECAST_BODY_SIZE_B),
+        .request_ms = request_ms
+    };
+
+    if (osMessageQueuePut(responses, &response, 0, 0) == osOK) return true;
+
+    // Can't happen while there are no more bodies than slots, but don't leak one
+    osMessageQueuePut(free_slots, &response.slot, 0, 0);
+    return false;
+}
+
+
+/**
+ * @brief Publish a forecast for display, replacing its location's last.
+ *
+ * The forecast is written into the inactive snapshot, which is then made
+ * active in one step, so readers never see a partly written forecast.
+ * There must only be one writer: the parse task, or `main()` before the
+ * scheduler starts.
+ *
+ * @param forecast: The forecast. Copied.
+ *
+ * @returns `true` if the forecast was published, or `false` if its
+ *          location is out of range.
+ */
+bool forecast_publish(const Forecast* forecast) {
+
+    uint32_t index = forecast->location == FORECAST_LOCATION_CACHED ? 0 : forecast->location;
+    if (index >= LOCATION_MAX) return false;
+
+    uint32_t sequence = snapshot_sequence;
+    const ForecastSnapshot* active = &snapshots[(sequence >> 1) & 1];
+    ForecastSnapshot* inactive = &snapshots[((sequence >> 1) + 1) & 1];
+
+    // Mark the write as started before touching the inactive buffer
+    snapshot_sequence = sequence + 1;
+    __DMB();
+
+    *inactive = *active;
+    inactive->forecasts[index] = *forecast;
+    inactive->versions[index] = (sequence >> 1) + 1;
+
+    // Make sure the buffer is complete before it's made active
+    __DMB();
+    snapshot_sequence = sequence + 2;
+    if (forecast->location != FORECAST_LOCATION_CACHED) latency_mark(forecast->location, LATENCY_STAGE_PUBLISHED);
+    return true;
+}
+
+
+/**
+ * @brief Render stage: copy the published forecasts, if they have
+ *        changed. Never blocks.
+ *
+ * The writer only ever writes the buffer that is not active, so a copy
+ * can only be torn if two forecasts are published while it is made.
+ * If so, it is made again.
+ *
+ * @param snapshot: Set to the forecasts.
+ * @param sequence: The sequence number of the last copy, or zero. Updated.
+ *
+ * @returns `true` if there was a new snapshot to copy, otherwise `false`.
+ */
+bool forecast_read(ForecastSnapshot* snapshot, uint32_t* sequence) {
+
+    while (true) {
+        uint32_t start = snapshot_sequence & ~1UL;
+        if (start == *sequence) return false;
+
+        __DMB();
+        *snapshot = snapshots[(start >> 1) & 1];
+        __DMB();
+
+        // The buffer copied is next written once the sequence passes `start + 2`
+        if (snapshot_sequence - start <= 2) {
+            *sequence = start;
+            return true;
+        }
+    }
+}
+
+
+/**
+ * @brief Take the outcome of parsing the first location's forecast,
+ *        valid or not, for polling. Does not block.
+ *
+ * @param forecast: Set to the forecast.
+ *
+ * @returns `true` if there was an outcome, otherwise `false`.
+ */
+bool forecast_take_result(Forecast* forecast) {
+
+    return (results != NULL && osMessageQueueGet(results, forecast, NULL, 0) == osOK);
+}
+
+
+/**
+ * @brief Parse stage: read the values we need from a OneCall response.
+ *
+ * @param body:   The response body.
+ * @param length: The body's length.
+ * @param fields: Set to the values read.
+ *
+ * @returns `true` if the body was parsed, otherwise `false`.
+ */
+bool forecast_parse(const char* body, uint32_t length, ForecastFields* fields) {
+
+    memset(fields, 0x00, sizeof(ForecastFields));
+
+    // Tokenize the incoming JSON in place. Values are
+    // only decoded as they are read below
+    JsonDoc json;
+    int32_t result = json_parse(&json, body, length, tokens, FORECAST_MAX_TOKENS);
+    if (result < 0) {
+        // Parsing failed -- log an error and bail
+        server_error("Cant parse JSON (%li)", result);
+        return false;
+    }
+
+    // Extract current weather conditions from parsed JSON
+    int32_t current = json_find(&json, 0, "current");
+    int32_t weather = json_find(&json, current, "weather");
+    int32_t item = -1;
+    for (uint32_t i = 0 ; i < FORECAST_MAX_CONDITIONS && (item = json_array_get(&json, weather, i)) >= 0 ; ++i) {
+        int64_t id = 0;
+        if (json_get_fixed(&json, json_find(&json, item, "id"), 0, &id)) fields->conditions[i].id = (uint32_t)id;
+
+        int32_t main = json_find(&json, item, "main");
+        if (json_type(&json, main) == JSON_TYPE_STRING) {
+            json_get_string(&json, main, fields->conditions[i].main, FORECAST_LABEL_LEN_B);
+        }
+
+        json_get_string(&json, json_find(&json, item, "icon"), fields->conditions[i].icon, 4);
+        fields->condition_count++;
+    }
+
+    json_get_number(&json, json_find(&json, current, "feels_like"), &fields->feels_like);
+
+    int64_t dt = 0;
+    if (json_get_fixed(&json, json_find(&json, current, "dt"), 0, &dt)) fields->timestamp = (uint32_t)dt;
+    return true;
+}
+
+
+/**
+ * @brief Classify stage: turn weather conditions into an icon and a label.
+ *
+ * @param fields:   The values read from a response.
+ * @param forecast: Set to the forecast, except its `location`, which is
+ *                  left as it is. `valid` is set if a condition was found.
+ */
+void forecast_classify(const ForecastFields* fields, Forecast* forecast) {
+
+    uint32_t wid = 0;
+    uint32_t code = NONE;
+    char cast[FORECAST_LABEL_LEN_B] = "None";
+
+    for (uint32_t i = 0 ; i < fields->condition_count ; ++i) {
+        // Set working values
+        const char* icon = fields->conditions[i].icon;
+        if (fields->conditions[i].id != 0) wid = fields->conditions[i].id;
+        if (fields->conditions[i].main[0] != 0) strcpy(cast, fields->conditions[i].main);
+
+        // Set standard icon values by weather condition
+        if (strcmp(cast, "Rain") == 0) {
+            code = RAIN;
+        } else if (strcmp(cast, "Snow") == 0) {
+            code = SNOW;
+        } else if (strcmp(cast, "Thun") == 0) {
+            code = THUNDERSTORM;
+        }
+
+        // Update icons and/or condition text for certain
+        // quirky ID values
+        if (wid == 771) {
+            strcpy(cast, "Windy");
+            code = WIND;
+        }
+
+        if (wid == 871) {
+            strcpy(cast, "Tornado");
+            code = TORNADO;
+        }
+
+        if (wid > 699 && wid < 770) {
+            strcpy(cast, "Foggy");
+            code = FOG;
+        }
+
+        if (strcmp(cast, "Clouds") == 0) {
+            if (wid < 804) {
+                strcpy(cast, "Partly Cloudy");
+                code = PARTLY_CLOUDY;
+            } else {
+                strcpy(cast, "Cloudy");
+                code = CLOUDY;
+            }
+        }
+
+        if (wid > 602 && wid < 620) {
+            strcpy(cast, "Sleet");
+            code = SLEET;
+        }
+
+        if (strcmp(cast, "Drizzle") == 0) {
+            code = DRIZZLE;
+        }
+
+        if (strcmp(cast, "Clear") == 0) {
+            if (icon[0] != 0) {
+                if (icon[2] == 'd') {
+                    code = CLEAR_DAY;
+                } else {
+                    code = CLEAR_NIGHT;
+                }
+            }
+        }
+    }
+
+    // Only use the temperature if we got updated weather info
+    double temp = wid > 0 ? fields->feels_like : 0.0;
+    forecast->timestamp = fields->timestamp;
+    forecast->temperature = (int16_t)(temp * 10.0 + (temp < 0.0 ? -0.5 : 0.5));
+    forecast->icon_code = (uint8_t)code;
+    forecast->valid = (wid > 0);
+    strcpy(forecast->label, cast);
+}
+
+
+/**
+ * @brief Render stage: format a forecast for the display.
+ *
+ * @param text:        The buffer to write the text into.
+ * @param size:        The size of the buffer. More than 6 bytes.
+ * @param name:        The location's name. May be empty.
+ * @param label:       The forecast description, eg. "Rain".
+ * @param temperature: The 'feels like' temperature, in tenths of a degree C.
+ */
+void forecast_render(char* text, uint32_t size, const char* name, const char* label, int16_t temperature) {
+
+    // Leave room for the degree sign and padding
+    snprintf(text, size - 6, "    %s%s%s Out: %.1f", name, (name[0] != 0 ? ": " : ""), label, temperature / 10.0);
+    strcat(text, "\x7F\x63\x20\x20\x20\x20");
+}
+
+
+/**
+ * @brief Time each pipeline stage on a sample OneCall response,
+ *        keeping the fastest of several runs.
+ *
+ * Call before the first poll, as parsing uses the parse stage's tokens.
+ */
+void forecast_benchmark(void) {
+
+    static const char body[] = "{\"lat\":51.5219,\"lon\":-0.1035,\"timezone\":\"Europe/London\",\"timezone_offset\":3600,"
+                               "\"current\":{\"dt\":1729267200,\"sunrise\":1729232580,\"sunset\":1729270740,\"temp\":14.52,"
+                               "\"feels_like\":13.98,\"pressure\":1012,\"humidity\":81,\"dew_point\":11.3,\"uvi\":0.41,"
+                               "\"clouds\":75,\"visibility\":10000,\"wind_speed\":5.14,\"wind_deg\":230,\"weather\":"
+                               "[{\"id\":803,\"main\":\"Clouds\",\"description\":\"broken clouds\",\"icon\":\"04d\"}]}}";
+    bool use_cyccnt = diag_cycle_counter_start();
+    uint32_t best[3] = { UINT32_MAX, UINT32_MAX, UINT32_MAX };
+    ForecastFields fields;
+    Forecast forecast;
+    char text[FORECAST_TEXT_LEN_B];
+
+    for (uint32_t i = 0 ; i < JSON_BENCHMARK_RUNS ; ++i) {
+        uint32_t start = use_cyccnt ? DWT->CYCCNT : HAL_GetTick();
+        forecast_parse(body, sizeof(body) - 1, &fields);
+        uint32_t parsed = use_cyccnt ? DWT->CYCCNT : HAL_GetTick();
+        forecast_classify(&fields, &forecast);
+        uint32_t classified = use_cyccnt ? DWT->CYCCNT : HAL_GetTick();
+        forecast_render(text, sizeof(text), "London", forecast.label, forecast.temperature);
+        uint32_t rendered = use_cyccnt ? DWT->CYCCNT : HAL_GetTick();
+
+        if (parsed - start < best[0]) best[0] = parsed - start;
+        if (classified - parsed < best[1]) best[1] = classified - parsed;
+        if (rendered - classified < best[2]) best[2] = rendered - classified;
+    }
+
+    LOG_INFO("Forecast stages: parse %lu, classify %lu, render %lu %s",
+             best[0], best[1], best[2], (use_cyccnt ? "cycles" : "ms"));
+}
+
+
+/**
+ * @brief Function implementing the forecast parse thread.
+ *
+ * @param *unused_arg: Not used.
+ */
+static void task_forecast(void *unused_arg) {
+
+    while (1) {
+        ForecastResponse response;
+        if (osMessageQueueGet(responses, &response, NULL, osWaitForever) == osOK) {
+            TRACE_SPAN_BEGIN(TRACE_SPAN_HTTP_RESPONSE);
+            forecast_process(&response);
+            TRACE_SPAN_END(TRACE_SPAN_HTTP_RESPONSE);
+        }
+    }
+}
+
+
+/**
+ * @brief Parse and classify a response body, then pass the forecast
+ *        on for display and, for the first location, to polling.
+ *
+ * @param response: The response body's details.
+ */
+static void forecast_process(const ForecastResponse* response) {
+
+    uint64_t start_us = 0;
+    mvGetMicroseconds(&start_us);
+
+    ForecastFields fields;
+    Forecast forecast;
+    memset(&forecast, 0x00, sizeof(Forecast));
+    bool parsed = forecast_parse(bodies[response->slot], response->length, &fields);
+
+    // The body is no longer needed, so the fetch stage can have it back
+    osMessageQueuePut(free_slots, &response->slot, 0, 0);
+
+    if (parsed) {
+        forecast_classify(&fields, &forecast);
+        latency_mark(response->location, LATENCY_STAGE_PARSED);
+
+        // Use our own time if OpenWeather's is missing
+        if (forecast.timestamp == 0) {
+            uint64_t usec = 0;
+            mvGetWallTime(&usec);
+            forecast.timestamp = (uint32_t)(usec / 1000000);
+        }
+
+        LOG_INFO("Forecast %lu: %s (code: %lu) Feels Like %.1f°C",
+                 (uint32_t)response->location + 1, forecast.label, (uint32_t)forecast.icon_code, forecast.temperature / 10.0);
+    }
+
+    forecast.location = response->location;
+
+    uint64_t end_us = 0;
+    mvGetMicroseconds(&end_us);
+    telemetry_record_request(response->request_ms, (uint32_t)(end_us - start_us));
+
+    if (forecast.valid) forecast_publish(&forecast);
+
+    if (forecast.location == 0 && osMessageQueuePut(results, &forecast, 0, 0) != osOK) {
+        LOG_WARN("Forecast result dropped");
+    }
+}
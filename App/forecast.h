@@ -0,0 +1,108 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _FORECAST_H_
+#define _FORECAST_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Response bodies are read into a pool of buffers, so the next request
+// can be made while the last response is parsed. Fetching waits for
+// nothing: if every buffer is in use, the response is dropped
+#define     FORECAST_BODY_SLOTS             2
+#define     FORECAST_BODY_SIZE_B            1500
+
+// Token storage for one forecast response. A OneCall
+// `current` response needs around 60
+#define     FORECAST_MAX_TOKENS             128
+
+// Weather conditions read from one response
+#define     FORECAST_MAX_CONDITIONS         4
+
+#define     FORECAST_LABEL_LEN_B            14
+#define     FORECAST_TEXT_LEN_B             48
+
+#define     FORECAST_RESULT_QUEUE_DEPTH     2
+
+// The `location` of a forecast loaded from the forecast cache. It is
+// published in the first location's place until that has a forecast
+#define     FORECAST_LOCATION_CACHED        0xFF
+
+
+/*
+ * STRUCTURES
+ */
+// A response body waiting to be parsed
+typedef struct {
+    uint8_t     slot;
+    uint8_t     location;
+    uint16_t    length;
+    uint32_t    request_ms;
+} ForecastResponse;
+
+// The values read from a response, before classification.
+// Missing values are zero or empty
+typedef struct {
+    struct {
+        uint32_t    id;
+        char        main[FORECAST_LABEL_LEN_B];
+        char        icon[4];
+    } conditions[FORECAST_MAX_CONDITIONS];
+    uint32_t    condition_count;
+    uint32_t    timestamp;
+    double      feels_like;
+} ForecastFields;
+
+// A classified forecast. Passed between tasks by value, and never
+// changed once sent. Only forecasts with `valid` set are shown
+typedef struct {
+    uint32_t    timestamp;                          // Unix epoch seconds
+    int16_t     temperature;                        // Tenths of a degree C
+    uint8_t     location;
+    uint8_t     icon_code;
+    bool        valid;
+    char        label[FORECAST_LABEL_LEN_B];
+} Forecast;
+
+// Every location's latest forecast, as published for display. A
+// location's `versions` entry changes each time its forecast does
+typedef struct {
+    Forecast    forecasts[LOCATION_MAX];
+    uint32_t    versions[LOCATION_MAX];
+} ForecastSnapshot;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        forecast_pipeline_init(void);
+char*       forecast_claim_buffer(uint32_t* slot);
+void        forecast_release_buffer(uint32_t slot);
+bool        forecast_submit(uint32_t slot, uint32_t location, uint32_t length, uint32_t request_ms);
+bool        forecast_publish(const Forecast* forecast);
+bool        forecast_read(ForecastSnapshot* snapshot, uint32_t* sequence);
+bool        forecast_take_result(Forecast* forecast);
+bool        forecast_parse(const char* body, uint32_t length, ForecastFields* fields);
+void        forecast_classify(const ForecastFields* fields, Forecast* forecast);
+void        forecast_render(char* text, uint32_t size, const char* name, const char* label, int16_t temperature);
+void        forecast_benchmark(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _FORECAST_H_
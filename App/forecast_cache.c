@@ -0,0 +1,223 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+#if ENABLE_FORECAST_CACHE == true
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     forecast_cache_scan(void);
+static bool     forecast_cache_fits(void);
+static uint32_t forecast_cache_checksum(const ForecastCacheRecord* record);
+static bool     forecast_cache_erase(uint32_t page);
+static const ForecastCacheRecord* forecast_cache_slot(uint32_t page, uint32_t slot);
+
+
+/*
+ * GLOBALS
+ */
+// Where the latest record is, and where the next one goes
+static bool     scanned = false;
+static const ForecastCacheRecord* latest = NULL;
+static uint32_t next_page = 0;
+static uint32_t next_slot = 0;
+static bool     usable = false;
+
+// From the linker script: where `.data`'s initial values are stored
+// in flash, the last part of the image, and the section's size
+extern uint32_t _sidata;
+extern uint32_t _sdata;
+extern uint32_t _edata;
+
+
+/**
+ * @brief Get the most recently saved forecast.
+ *
+ * @param record: The record is written here.
+ *
+ * @returns `true` if a valid record was found, otherwise `false`.
+ */
+bool forecast_cache_load(ForecastCacheRecord* record) {
+
+    if (!scanned) forecast_cache_scan();
+    if (!usable || latest == NULL) return false;
+
+    *record = *latest;
+    record->label[FORECAST_CACHE_LABEL_LEN_B - 1] = 0;
+    return true;
+}
+
+
+/**
+ * @brief Append a forecast to the cache.
+ *
+ * May erase a flash page, which takes a few milliseconds.
+ *
+ * @param icon_code:   The forecast's icon, eg. `RAIN`.
+ * @param label:       The forecast's description. Truncated to fit.
+ * @param temperature: The forecast's temperature.
+ * @param timestamp:   The forecast's time, in Unix epoch seconds.
+ *
+ * @returns `true` if the forecast was written, otherwise `false`.
+ */
+bool forecast_cache_save(uint32_t icon_code, const char* label, double temperature, uint32_t timestamp) {
+
+    if (!scanned) forecast_cache_scan();
+    if (!usable) return false;
+
+    // Records are programmed a quad-word at a time from this
+    ForecastCacheRecord record __attribute__((aligned(16))) = { 0 };
+    record.magic = FORECAST_CACHE_MAGIC;
+    record.sequence = (latest != NULL ? latest->sequence + 1 : 1);
+    record.timestamp = timestamp;
+    record.temperature = (int32_t)(temperature * 10.0 + (temperature < 0 ? -0.5 : 0.5));
+    record.icon_code = icon_code;
+    strncpy(record.label, label, FORECAST_CACHE_LABEL_LEN_B - 1);
+    record.checksum = forecast_cache_checksum(&record);
+
+    HAL_FLASH_Unlock();
+
+    // Move to the other page if this one is full
+    if (next_slot >= FORECAST_CACHE_RECORDS_PER_PAGE) {
+        next_page = (next_page + 1) % FORECAST_CACHE_PAGE_COUNT;
+        next_slot = 0;
+    }
+
+    // Erase the page if we're starting it, unless it's already blank
+    bool success = true;
+    if (next_slot == 0 && forecast_cache_slot(next_page, 0)->magic != 0xFFFFFFFF) {
+        success = forecast_cache_erase(next_page);
+    }
+
+    const ForecastCacheRecord* slot = forecast_cache_slot(next_page, next_slot);
+    const uint32_t* words = (const uint32_t*)&record;
+    for (uint32_t i = 0 ; success && i < sizeof(ForecastCacheRecord) ; i += 16) {
+        success = HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, (uint32_t)(uintptr_t)slot + i, (uint32_t)(uintptr_t)&words[i / 4]) == HAL_OK;
+    }
+
+    HAL_FLASH_Lock();
+
+    // The slot is used whether or not it was written correctly
+    next_slot++;
+    if (!success) {
+        server_error("Could not write forecast cache (page %lu, slot %lu)", next_page, next_slot - 1);
+        return false;
+    }
+
+    latest = slot;
+    return true;
+}
+
+
+/**
+ * @brief Find the latest valid record, and the first unused slot after it.
+ */
+static void forecast_cache_scan(void) {
+
+    scanned = true;
+    usable = forecast_cache_fits();
+    if (!usable) return;
+
+    for (uint32_t page = 0 ; page < FORECAST_CACHE_PAGE_COUNT ; ++page) {
+        for (uint32_t slot = 0 ; slot < FORECAST_CACHE_RECORDS_PER_PAGE ; ++slot) {
+            const ForecastCacheRecord* record = forecast_cache_slot(page, slot);
+            if (record->magic == 0xFFFFFFFF) break;
+
+            // Skip partly written records
+            if (record->magic != FORECAST_CACHE_MAGIC || record->checksum != forecast_cache_checksum(record)) continue;
+            if (latest == NULL || record->sequence > latest->sequence) {
+                latest = record;
+                next_page = page;
+            }
+        }
+    }
+
+    // Carry on after the latest record's page's last used slot
+    next_slot = 0;
+    while (next_slot < FORECAST_CACHE_RECORDS_PER_PAGE && forecast_cache_slot(next_page, next_slot)->magic != 0xFFFFFFFF) {
+        next_slot++;
+    }
+}
+
+
+/**
+ * @brief Check that the cache's pages lie beyond the end of the image,
+ *        so erasing them can't destroy the application.
+ *
+ * @returns `true` if the cache can be used, otherwise `false`.
+ */
+static bool forecast_cache_fits(void) {
+
+    uint32_t image_end = (uint32_t)(uintptr_t)&_sidata + ((uint32_t)(uintptr_t)&_edata - (uint32_t)(uintptr_t)&_sdata);
+    if (FORECAST_CACHE_ADDR >= image_end && FORECAST_CACHE_ADDR % FLASH_PAGE_SIZE == 0) return true;
+
+    server_error("Forecast cache at 0x%08lX overlaps the application image (ends 0x%08lX): cache disabled", (uint32_t)FORECAST_CACHE_ADDR, image_end);
+    return false;
+}
+
+
+/**
+ * @brief FNV-1a hash of a record's content.
+ *
+ * @param record: The record.
+ *
+ * @returns The checksum.
+ */
+static uint32_t forecast_cache_checksum(const ForecastCacheRecord* record) {
+
+    const uint8_t* data = (const uint8_t*)record;
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0 ; i < offsetof(ForecastCacheRecord, checksum) ; ++i) {
+        hash = (hash ^ data[i]) * 16777619UL;
+    }
+
+    return hash;
+}
+
+
+/**
+ * @brief Erase one of the cache's flash pages. Flash must be unlocked.
+ *
+ * @param page: The cache page, 0 or 1.
+ *
+ * @returns `true` if the page was erased, otherwise `false`.
+ */
+static bool forecast_cache_erase(uint32_t page) {
+
+    uint32_t address = FORECAST_CACHE_ADDR + page * FLASH_PAGE_SIZE;
+    uint32_t offset = address - FLASH_BASE;
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGES,
+        .Banks = offset < FLASH_BANK_SIZE ? FLASH_BANK_1 : FLASH_BANK_2,
+        .Page = (offset % FLASH_BANK_SIZE) / FLASH_PAGE_SIZE,
+        .NbPages = 1
+    };
+
+    uint32_t page_error = 0;
+    return HAL_FLASHEx_Erase(&erase, &page_error) == HAL_OK;
+}
+
+
+/**
+ * @brief Locate a record slot in flash.
+ *
+ * @param page: The cache page, 0 or 1.
+ * @param slot: The record's index within the page.
+ *
+ * @returns A pointer to the slot.
+ */
+static const ForecastCacheRecord* forecast_cache_slot(uint32_t page, uint32_t slot) {
+
+    return (const ForecastCacheRecord*)(FORECAST_CACHE_ADDR + page * FLASH_PAGE_SIZE + slot * sizeof(ForecastCacheRecord));
+}
+
+
+#endif      // ENABLE_FORECAST_CACHE
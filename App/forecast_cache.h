@@ -0,0 +1,64 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _FORECAST_CACHE_H_
+#define _FORECAST_CACHE_H_
+
+
+/*
+ * CONSTANTS
+ */
+// The cache occupies two flash pages, which must lie beyond the end
+// of the application image, or the cache is disabled. Records are appended to one page until it is
+// full, then the other is erased and used, so each page is erased
+// once per `FORECAST_CACHE_RECORDS_PER_PAGE` forecasts
+#ifndef     FORECAST_CACHE_ADDR
+#define     FORECAST_CACHE_ADDR                 0x081FC000      // Last 16KB of bank 2
+#endif
+#define     FORECAST_CACHE_PAGE_COUNT           2
+#define     FORECAST_CACHE_RECORDS_PER_PAGE     (FLASH_PAGE_SIZE / sizeof(ForecastCacheRecord))
+#define     FORECAST_CACHE_MAGIC                0x43464F57      // 'WOFC'
+#define     FORECAST_CACHE_LABEL_LEN_B          24
+
+// Cached forecasts older than this are not shown
+#define     FORECAST_CACHE_TTL_S                3600
+
+
+/*
+ * STRUCTURES
+ */
+// A multiple of the 16-byte flash programming unit
+typedef struct {
+    uint32_t    magic;
+    uint32_t    sequence;
+    uint32_t    timestamp;                          // Forecast time, Unix epoch seconds
+    int32_t     temperature;                        // In tenths of a degree
+    uint32_t    icon_code;
+    char        label[FORECAST_CACHE_LABEL_LEN_B];
+    uint32_t    checksum;
+} ForecastCacheRecord;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+bool        forecast_cache_load(ForecastCacheRecord* record);
+bool        forecast_cache_save(uint32_t icon_code, const char* label, double temperature, uint32_t timestamp);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _FORECAST_CACHE_H_
@@ -14,14 +14,12 @@
  */
 static void HT16K33_write_cmd(uint8_t cmd);
 static void HT16K33_rotate(uint8_t angle);
+static void HT16K33_frame_sent(void* context, bool success);
 
 
 /*
  * GLOBALS
  */
-// Defined in `main.c`
-extern I2C_HandleTypeDef i2c;
-
 // The Ascii character set
 static const char CHARSET[128][6] = {
     "\x00\x00\x00",              // space - Ascii 32
@@ -151,13 +149,13 @@ void HT16K33_init(uint8_t angle) {
 
 
 /**
- * @brief Issue a single command byte to the HT16K33.
+ * @brief Queue a single command byte for the HT16K33.
  *
  * @param cmd: The single-byte command.
  */
 static void HT16K33_write_cmd(uint8_t cmd) {
 
-    HAL_I2C_Master_Transmit(&i2c, HT16K33_I2C_ADDR << 1, &cmd, 1, 100);
+    I2C_write(HT16K33_I2C_ADDR, &cmd, 1, I2C_PRIORITY_LOW, false, NULL, NULL);
 }
 
 
@@ -202,6 +200,8 @@ void HT16K33_clear_buffer(void) {
  */
 void HT16K33_draw(void) {
 
+    TRACE_SPAN_BEGIN(TRACE_SPAN_DISPLAY_DRAW);
+
     // Set up the buffer holding the data to be
     // transmitted to the LED
     uint8_t tx_buffer[17] = { 0 };
@@ -217,8 +217,10 @@ void HT16K33_draw(void) {
         tx_buffer[i * 2 + 1] = (a >> 1) + ((a << 7) & 0xFF);
     }
 
-    // Display the buffer and flash the LED
-    HAL_I2C_Master_Transmit(&i2c, HT16K33_I2C_ADDR << 1, tx_buffer, sizeof(tx_buffer), 100);
+    // Queue the buffer for display. Only the latest
+    // frame still waiting for the bus is sent
+    I2C_write(HT16K33_I2C_ADDR, tx_buffer, sizeof(tx_buffer), I2C_PRIORITY_LOW, true, HT16K33_frame_sent, NULL);
+    TRACE_SPAN_END(TRACE_SPAN_DISPLAY_DRAW);
 }
 
 
@@ -248,6 +250,8 @@ void HT16K33_plot(uint8_t x, uint8_t y, bool is_set) {
  */
 void HT16K33_print(const char *text, uint32_t delay_ms) {
 
+    TRACE_SPAN_BEGIN(TRACE_SPAN_DISPLAY_PRINT);
+
     // Get the length of the text: the number of columns it encompasses
     uint length = 0;
     for (size_t i = 0 ; i < strlen(text) ; ++i) {
@@ -293,8 +297,10 @@ void HT16K33_print(const char *text, uint32_t delay_ms) {
         HT16K33_draw();
         cursor++;
         if (cursor > length - 8) break;
-        sleep_ms(display_angle == 0 ? delay_ms : (delay_ms * 2 / 3));
+        osDelay(display_angle == 0 ? delay_ms : (delay_ms * 2 / 3));
     };
+
+    TRACE_SPAN_END(TRACE_SPAN_DISPLAY_PRINT);
 }
 
 
@@ -354,3 +360,17 @@ static void HT16K33_rotate(uint8_t angle) {
     // Swap the matrices
     memcpy(display_buffer, temp, 8);
 }
+
+
+/**
+ * @brief Count a frame that reached the display.
+ *
+ * Called from the I2C bus manager task.
+ *
+ * @param context: Unused.
+ * @param success: Whether the frame was sent.
+ */
+static void HT16K33_frame_sent(void* context, bool success) {
+
+    if (success) telemetry_count_frame();
+}
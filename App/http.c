@@ -23,9 +23,6 @@ struct {
 // Defined in `main.c`
 extern volatile bool        received_request;
 extern volatile bool        channel_was_closed;
-extern volatile bool        new_forecast;
-extern volatile uint32_t    icon_code;
-extern          char        forecast[32];
 
 
 /**
@@ -106,40 +103,59 @@ void http_close_channel(void) {
 /**
  * @brief Send an HTTP request.
  *
- * @params url - The URL of the target resource.
+ * A request with a body is sent as JSON.
  *
- * @returns `true` if the request was accepted by Microvisor, otherwise `false`
+ * @param method:      The HTTP method, eg. "GET".
+ * @param url:         The URL of the target resource.
+ * @param body:        The request body, or `NULL` for none.
+ * @param body_length: The length of the body in bytes.
+ *
+ * @returns The Microvisor status: `MV_STATUS_OKAY` if the request was accepted.
  */
-enum MvStatus http_send_request(const char* url) {
+enum MvStatus http_send_request(const char* method, const char* url, const char* body, uint32_t body_length) {
 
     // Check for a valid channel handle
     if (http_handles.channel == 0) {
         // There's no open channel, so open open one now and
         // try to send again
         http_open_channel();
-        return http_send_request(url);
+        return http_send_request(method, url, body, body_length);
     }
 
-    server_log("Sending HTTP request");
+    TRACE_SPAN_BEGIN(TRACE_SPAN_HTTP_SEND);
+    server_log("Sending HTTP %s request", method);
 
     // Set up the request
-    const char verb[] = "GET";
-    const char body[] = "";
-    struct MvHttpHeader hdrs[] = {};
+    static const char content_type[] = "Content-Type";
+    static const char json_type[] = "application/json";
+    struct MvHttpHeader hdrs[] = {
+        {
+            .name = {
+                .data = (uint8_t *)content_type,
+                .length = sizeof(content_type) - 1
+            },
+            .value = {
+                .data = (uint8_t *)json_type,
+                .length = sizeof(json_type) - 1
+            }
+        }
+    };
+
+    if (body == NULL) body_length = 0;
     struct MvHttpRequest request_config = {
         .method = {
-            .data = (uint8_t *)verb,
-            .length = strlen(verb)
+            .data = (uint8_t *)method,
+            .length = strlen(method)
         },
         .url = {
             .data = (uint8_t *)url,
             .length = strlen(url)
         },
-        .num_headers = 0,
+        .num_headers = (body_length > 0 ? 1 : 0),
         .headers = hdrs,
         .body = {
-            .data = (uint8_t *)body,
-            .length = strlen(body)
+            .data = (uint8_t *)(body_length > 0 ? body : ""),
+            .length = body_length
         },
         .timeout_ms = 10000
     };
@@ -154,6 +170,7 @@ enum MvStatus http_send_request(const char* url) {
         server_error("Could not issue request. Status: %i", status);
     }
 
+    TRACE_SPAN_END(TRACE_SPAN_HTTP_SEND);
     return status;
 }
 
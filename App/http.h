@@ -14,7 +14,9 @@
  * CONSTANTS
  */
 #define         HTTP_RX_BUFFER_SIZE_B           2560
-#define         HTTP_TX_BUFFER_SIZE_B           512
+// The send buffer holds a whole request, so must fit the
+// largest telemetry batch plus its URL and headers
+#define         HTTP_TX_BUFFER_SIZE_B           1536
 #define         HTTP_NC_BUFFER_SIZE_R           8       // NOTE Size in records, not bytes
 
 
@@ -28,7 +30,7 @@ extern "C" {
  */
 bool            http_open_channel(void);
 void            http_close_channel(void);
-enum MvStatus   http_send_request(const char* url);
+enum MvStatus   http_send_request(const char* method, const char* url, const char* body, uint32_t body_length);
 
 
 #ifdef __cplusplus
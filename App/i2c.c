@@ -11,18 +11,56 @@
 /*
  * STATIC PROTOTYPES
  */
-static bool I2C_check(uint8_t addr);
+static void         task_i2c(void *unused_arg);
+static bool         I2C_check(uint8_t addr);
+static I2CRequest*  I2C_claim(I2CPriority priority);
+static bool         I2C_acquire(osSemaphoreId_t semaphore);
+static void         I2C_queue(I2CRequest* request);
+static I2CRequest*  I2C_next_request(void);
+static bool         I2C_transfer(I2CRequest* request);
+static void         I2C_release(I2CRequest* request);
+static void         I2C_reset(void);
+static void         I2C_transfer_done(bool success);
+static void         I2C_read_done(void* context, bool success);
 
 
 /*
  * GLOBALS
  */
-extern      I2C_HandleTypeDef   i2c;
 extern      bool                use_i2c;
 
+// I2C1 belongs to the bus manager task once it starts: other
+// code makes requests with `I2C_write()` and `I2C_read()`
+static I2C_HandleTypeDef i2c;
+#if ENABLE_I2C_DMA == true
+static DMA_HandleTypeDef dma_tx;
+static DMA_HandleTypeDef dma_rx;
+#endif
+
+// This is the FreeRTOS thread task that runs every transaction on the bus
+static osThreadId_t thread_i2c = NULL;
+static const osThreadAttr_t i2c_task_attributes = {
+    .name = "I2CTask",
+    .stack_size = 2048,
+    .priority = (osPriority_t)osPriorityAboveNormal
+};
+
+// Requests, queued and otherwise. The semaphores count free requests,
+// and those still free to low-priority writes
+static I2CRequest           requests[I2C_QUEUE_DEPTH];
+static uint32_t             next_sequence = 0;
+static osSemaphoreId_t      free_requests = NULL;
+static osSemaphoreId_t      free_low_requests = NULL;
+static volatile bool        transfer_ok = false;
+
+// Metrics
+static I2CStats             stats = { 0 };
+static uint64_t             busy_cycles = 0;
+static uint32_t             stats_tick = 0;
+
 
 /**
- * @brief Initialize STM32U585 I2C1.
+ * @brief Initialize STM32U585 I2C1 and start the bus manager task.
  */
 void I2C_init(void) {
 
@@ -45,14 +83,40 @@ void I2C_init(void) {
         return;
     }
 
-    // Check peripheral readiness
+    // Enable the event and error interrupts used by queued transfers
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, I2C_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+    HAL_NVIC_SetPriority(I2C1_ER_IRQn, I2C_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+#if ENABLE_I2C_DMA == true
+    HAL_NVIC_SetPriority(I2C_DMA_TX_IRQ, I2C_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(I2C_DMA_TX_IRQ);
+    HAL_NVIC_SetPriority(I2C_DMA_RX_IRQ, I2C_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(I2C_DMA_RX_IRQ);
+#endif
+
+    // Check peripheral readiness. Nothing else is using the bus yet
     use_i2c = I2C_check(HT16K33_I2C_ADDR);
+
+    // Hand the bus to its manager
+    free_requests = osSemaphoreNew(I2C_QUEUE_DEPTH, I2C_QUEUE_DEPTH, NULL);
+    free_low_requests = osSemaphoreNew(I2C_LOW_PRIORITY_MAX, I2C_LOW_PRIORITY_MAX, NULL);
+    if (free_requests == NULL || free_low_requests == NULL) {
+        server_error("Could not create I2C request semaphores");
+        return;
+    }
+
+    stats_tick = HAL_GetTick();
+    thread_i2c = osThreadNew(task_i2c, NULL, &i2c_task_attributes);
+    if (thread_i2c == NULL) server_error("Could not start I2C task");
 }
 
 
 /**
  * @brief Check for presence of a known device by its I2C address.
  *
+ * Called from a task, so retries yield to other tasks.
+ *
  * @param addr: The device's address.
  *
  * @returns `true` if the device is present, otherwise `false`.
@@ -74,10 +138,10 @@ static bool I2C_check(uint8_t addr) {
         // Flash the LED eight times on device not ready
         for (uint8_t i = 0 ; i < 8 ; ++i) {
             HAL_GPIO_TogglePin(LED_GPIO_BANK, LED_GPIO_PIN);
-            HAL_Delay(100);
+            osDelay(100);
         }
 
-        HAL_Delay(1000);
+        osDelay(1000);
         timeout_count++;
         if (timeout_count > 10) break;
     }
@@ -88,15 +152,378 @@ static bool I2C_check(uint8_t addr) {
 
 /**
  * @brief Scan for and list I2C devices on the bus.
+ *
+ * Each address is probed with a one-byte read of register 0,
+ * so absent devices are counted as transfer errors.
  */
 void I2C_scan(void) {
 
     uint8_t data = 0;
-    for (uint8_t i = 2 ; i < 256 ; i += 2) {
-        if (HAL_I2C_Master_Receive(&i2c, i , &data, 1, 10) == HAL_OK) {
-            server_log("I2C device at %02x", i);
+    for (uint8_t addr = 1 ; addr < 128 ; ++addr) {
+        if (I2C_read(addr, 0, &data, 1)) {
+            server_log("I2C device at %02x", addr << 1);
+        }
+    }
+}
+
+
+/**
+ * @brief Queue a write to a device.
+ *
+ * Only waits if there is no free request, and then for no more than
+ * `I2C_QUEUE_TIMEOUT_MS`. A coalescing write replaces a queued
+ * coalescing write of the same length to the same register of the same
+ * device, in its place in the queue. The replaced write's `done` is
+ * not called.
+ *
+ * @param addr:     The device's 7-bit address.
+ * @param data:     The bytes to send, first the register.
+ * @param length:   The number of bytes. Up to `I2C_WRITE_MAX_B`.
+ * @param priority: The write's priority.
+ * @param coalesce: Whether a later write may replace this one.
+ * @param done:     A function to call when the write ends, or `NULL`.
+ * @param context:  A value to pass to `done`.
+ *
+ * @returns `true` if the write was queued, otherwise `false`.
+ */
+bool I2C_write(uint8_t addr, const uint8_t* data, uint32_t length, I2CPriority priority, bool coalesce, I2CDone done, void* context) {
+
+    if (thread_i2c == NULL || length == 0 || length > I2C_WRITE_MAX_B || priority >= I2C_PRIORITY_COUNT) return false;
+
+    if (coalesce) {
+        bool replaced = false;
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        for (uint32_t i = 0 ; i < I2C_QUEUE_DEPTH ; ++i) {
+            I2CRequest* request = &requests[i];
+            if (request->state == I2C_REQUEST_QUEUED && request->coalesce && request->addr == addr && request->priority == priority
+                && request->length == length && request->data[0] == data[0]) {
+                memcpy(request->data, data, length);
+                request->done = done;
+                request->context = context;
+                stats.coalesced++;
+                replaced = true;
+                break;
+            }
+        }
+
+        __set_PRIMASK(primask);
+        if (replaced) return true;
+    }
+
+    I2CRequest* request = I2C_claim(priority);
+    if (request == NULL) return false;
+
+    memcpy(request->data, data, length);
+    request->addr = addr;
+    request->priority = priority;
+    request->is_read = false;
+    request->coalesce = coalesce;
+    request->length = (uint16_t)length;
+    request->rx = NULL;
+    request->done = done;
+    request->context = context;
+    I2C_queue(request);
+    return true;
+}
+
+
+/**
+ * @brief Read from a device's registers, waiting for the data.
+ *
+ * Reads are high priority, so wait for no more than the transfer on
+ * the bus and any high-priority requests queued before them.
+ *
+ * @param addr:   The device's 7-bit address.
+ * @param reg:    The first register to read.
+ * @param data:   The buffer to read into.
+ * @param length: The number of bytes to read.
+ *
+ * @returns `true` if the data was read, otherwise `false`.
+ */
+bool I2C_read(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t length) {
+
+    if (thread_i2c == NULL || length == 0) return false;
+
+    I2CRequest* request = I2C_claim(I2C_PRIORITY_HIGH);
+    if (request == NULL) return false;
+
+    I2CReader reader = { .thread = osThreadGetId(), .success = false };
+    request->addr = addr;
+    request->reg = reg;
+    request->priority = I2C_PRIORITY_HIGH;
+    request->is_read = true;
+    request->coalesce = false;
+    request->length = length;
+    request->rx = data;
+    request->done = I2C_read_done;
+    request->context = &reader;
+    I2C_queue(request);
+
+    // The manager always answers, as it abandons stuck transfers
+    osThreadFlagsWait(I2C_FLAG_READ_DONE, osFlagsWaitAny, osWaitForever);
+    return reader.success;
+}
+
+
+/**
+ * @brief Get the bus metrics, and start a new period for bus time.
+ *
+ * @param copy: Set to the metrics.
+ */
+void I2C_get_stats(I2CStats* copy) {
+
+    uint32_t tick = HAL_GetTick();
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    stats.busy_us = (uint32_t)(busy_cycles / (SystemCoreClock / 1000000));
+    stats.period_ms = tick - stats_tick;
+    *copy = stats;
+    busy_cycles = 0;
+    stats_tick = tick;
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief The bus manager: run queued requests one at a time,
+ *        highest priority first.
+ *
+ * A transfer on the bus is never interrupted, so a request waits
+ * for at most that one transfer and any queued ahead of it at its
+ * own or a higher priority.
+ *
+ * @param unused_arg: Not used.
+ */
+static void task_i2c(void *unused_arg) {
+
+    while (true) {
+        I2CRequest* request = I2C_next_request();
+        if (request == NULL) {
+            osThreadFlagsWait(I2C_FLAG_REQUEST, osFlagsWaitAny, osWaitForever);
+            continue;
+        }
+
+        bool success = I2C_transfer(request);
+        if (request->done != NULL) request->done(request->context, success);
+        I2C_release(request);
+    }
+}
+
+
+/**
+ * @brief Take a free request.
+ *
+ * @param priority: The priority of the request.
+ *
+ * @returns The request, or `NULL` if none became free in time.
+ */
+static I2CRequest* I2C_claim(I2CPriority priority) {
+
+    if (priority == I2C_PRIORITY_LOW && !I2C_acquire(free_low_requests)) return NULL;
+    if (!I2C_acquire(free_requests)) {
+        if (priority == I2C_PRIORITY_LOW) osSemaphoreRelease(free_low_requests);
+        return NULL;
+    }
+
+    // The semaphore guarantees there is a free request
+    I2CRequest* request = NULL;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t i = 0 ; i < I2C_QUEUE_DEPTH ; ++i) {
+        if (requests[i].state == I2C_REQUEST_FREE) {
+            request = &requests[i];
+            request->state = I2C_REQUEST_CLAIMED;
+            break;
+        }
+    }
+
+    __set_PRIMASK(primask);
+    return request;
+}
+
+
+/**
+ * @brief Acquire a semaphore, waiting up to `I2C_QUEUE_TIMEOUT_MS`
+ *        if it is not free, and counting waits and failures.
+ *
+ * @param semaphore: The semaphore.
+ *
+ * @returns `true` if the semaphore was acquired, otherwise `false`.
+ */
+static bool I2C_acquire(osSemaphoreId_t semaphore) {
+
+    if (osSemaphoreAcquire(semaphore, 0) == osOK) return true;
+
+    stats.queue_waits++;
+    if (osSemaphoreAcquire(semaphore, I2C_QUEUE_TIMEOUT_MS) == osOK) return true;
+
+    stats.dropped++;
+    return false;
+}
+
+
+/**
+ * @brief Queue a claimed and filled-in request, and wake the manager.
+ *
+ * @param request: The request.
+ */
+static void I2C_queue(I2CRequest* request) {
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    request->sequence = next_sequence++;
+    request->queued_cycles = DWT->CYCCNT;
+    request->state = I2C_REQUEST_QUEUED;
+    __set_PRIMASK(primask);
+
+    osThreadFlagsSet(thread_i2c, I2C_FLAG_REQUEST);
+}
+
+
+/**
+ * @brief Take the next request to run: the oldest at the highest
+ *        priority queued.
+ *
+ * @returns The request, or `NULL` if none is queued.
+ */
+static I2CRequest* I2C_next_request(void) {
+
+    I2CRequest* next = NULL;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t i = 0 ; i < I2C_QUEUE_DEPTH ; ++i) {
+        I2CRequest* request = &requests[i];
+        if (request->state != I2C_REQUEST_QUEUED) continue;
+        if (next == NULL || request->priority < next->priority
+            || (request->priority == next->priority && (int32_t)(request->sequence - next->sequence) < 0)) {
+            next = request;
+        }
+    }
+
+    if (next != NULL) {
+        next->state = I2C_REQUEST_ACTIVE;
+        uint32_t wait_us = (DWT->CYCCNT - next->queued_cycles) / (SystemCoreClock / 1000000);
+        if (wait_us > stats.max_wait_us[next->priority]) stats.max_wait_us[next->priority] = wait_us;
+    }
+
+    __set_PRIMASK(primask);
+    return next;
+}
+
+
+/**
+ * @brief Run a request's transfer, and wait for it to end.
+ *
+ * A transfer that does not end within `I2C_TRANSFER_TIMEOUT_MS`
+ * is abandoned and the peripheral reset.
+ *
+ * @param request: The request.
+ *
+ * @returns `true` if the transfer succeeded, otherwise `false`.
+ */
+static bool I2C_transfer(I2CRequest* request) {
+
+    // Ignore the end of any transfer abandoned earlier
+    osThreadFlagsClear(I2C_FLAG_TRANSFER_DONE);
+    transfer_ok = false;
+
+    uint16_t addr = request->addr << 1;
+#if ENABLE_I2C_DMA == true
+    bool use_dma = (request->length >= I2C_DMA_MIN_B);
+#else
+    bool use_dma = false;
+#endif
+    uint32_t start = DWT->CYCCNT;
+    HAL_StatusTypeDef status;
+    if (request->is_read) {
+        status = use_dma ? HAL_I2C_Mem_Read_DMA(&i2c, addr, request->reg, I2C_MEMADD_SIZE_8BIT, request->rx, request->length)
+                         : HAL_I2C_Mem_Read_IT(&i2c, addr, request->reg, I2C_MEMADD_SIZE_8BIT, request->rx, request->length);
+    } else {
+        status = use_dma ? HAL_I2C_Master_Transmit_DMA(&i2c, addr, request->data, request->length)
+                         : HAL_I2C_Master_Transmit_IT(&i2c, addr, request->data, request->length);
+    }
+
+    bool success = false;
+    if (status == HAL_OK) {
+        uint32_t flags = osThreadFlagsWait(I2C_FLAG_TRANSFER_DONE, osFlagsWaitAny, I2C_TRANSFER_TIMEOUT_MS);
+        if (flags & osFlagsError) {
+            server_error("I2C transfer to %02x timed out", request->addr);
+            I2C_reset();
+        } else {
+            success = transfer_ok;
         }
     }
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    uint32_t transfer_us = cycles / (SystemCoreClock / 1000000);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    busy_cycles += cycles;
+    if (transfer_us > stats.max_transfer_us) stats.max_transfer_us = transfer_us;
+    if (success) {
+        stats.transfers++;
+    } else {
+        stats.errors++;
+    }
+
+    __set_PRIMASK(primask);
+
+    if (!success) telemetry_count_i2c_error();
+    return success;
+}
+
+
+/**
+ * @brief Return a finished request to the pool.
+ *
+ * @param request: The request.
+ */
+static void I2C_release(I2CRequest* request) {
+
+    I2CPriority priority = (I2CPriority)request->priority;
+    request->state = I2C_REQUEST_FREE;
+    osSemaphoreRelease(free_requests);
+    if (priority == I2C_PRIORITY_LOW) osSemaphoreRelease(free_low_requests);
+}
+
+
+/**
+ * @brief Reset the peripheral after a stuck transfer.
+ */
+static void I2C_reset(void) {
+
+    HAL_I2C_DeInit(&i2c);
+    if (HAL_I2C_Init(&i2c) != HAL_OK) server_error("I2C reset failed");
+}
+
+
+/**
+ * @brief Signal the end of the transfer on the bus to the manager.
+ *
+ * Called from the I2C interrupt, via the HAL's callbacks.
+ *
+ * @param success: Whether the transfer succeeded.
+ */
+static void I2C_transfer_done(bool success) {
+
+    transfer_ok = success;
+    if (thread_i2c != NULL) osThreadFlagsSet(thread_i2c, I2C_FLAG_TRANSFER_DONE);
+}
+
+
+/**
+ * @brief Wake the task waiting for a read.
+ *
+ * @param context: The reader.
+ * @param success: Whether the read succeeded.
+ */
+static void I2C_read_done(void* context, bool success) {
+
+    I2CReader* reader = (I2CReader*)context;
+    osThreadId_t thread = reader->thread;
+    reader->success = success;
+    osThreadFlagsSet(thread, I2C_FLAG_READ_DONE);
 }
 
 
@@ -138,4 +565,115 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef *i2c) {
 
     // Enable the I2C1 clock
     __HAL_RCC_I2C1_CLK_ENABLE();
+
+#if ENABLE_I2C_DMA == true
+    // Set up a GPDMA channel for each direction, byte by byte
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+    dma_tx.Instance                         = I2C_DMA_TX_CHANNEL;
+    dma_tx.Init.Request                     = GPDMA1_REQUEST_I2C1_TX;
+    dma_tx.Init.BlkHWRequest                = DMA_BREQ_SINGLE_BURST;
+    dma_tx.Init.Direction                   = DMA_MEMORY_TO_PERIPH;
+    dma_tx.Init.SrcInc                      = DMA_SINC_INCREMENTED;
+    dma_tx.Init.DestInc                     = DMA_DINC_FIXED;
+    dma_tx.Init.SrcDataWidth                = DMA_SRC_DATAWIDTH_BYTE;
+    dma_tx.Init.DestDataWidth               = DMA_DEST_DATAWIDTH_BYTE;
+    dma_tx.Init.Priority                    = DMA_LOW_PRIORITY_HIGH_WEIGHT;
+    dma_tx.Init.SrcBurstLength              = 1;
+    dma_tx.Init.DestBurstLength             = 1;
+    dma_tx.Init.TransferAllocatedPort       = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT1;
+    dma_tx.Init.TransferEventMode           = DMA_TCEM_BLOCK_TRANSFER;
+    dma_tx.Init.Mode                        = DMA_NORMAL;
+    if (HAL_DMA_Init(&dma_tx) != HAL_OK) {
+        server_error("I2C TX DMA init failed");
+        return;
+    }
+
+    __HAL_LINKDMA(i2c, hdmatx, dma_tx);
+
+    dma_rx.Instance                         = I2C_DMA_RX_CHANNEL;
+    dma_rx.Init                             = dma_tx.Init;
+    dma_rx.Init.Request                     = GPDMA1_REQUEST_I2C1_RX;
+    dma_rx.Init.Direction                   = DMA_PERIPH_TO_MEMORY;
+    dma_rx.Init.SrcInc                      = DMA_SINC_FIXED;
+    dma_rx.Init.DestInc                     = DMA_DINC_INCREMENTED;
+    dma_rx.Init.TransferAllocatedPort       = DMA_SRC_ALLOCATED_PORT1 | DMA_DEST_ALLOCATED_PORT0;
+    if (HAL_DMA_Init(&dma_rx) != HAL_OK) {
+        server_error("I2C RX DMA init failed");
+        return;
+    }
+
+    __HAL_LINKDMA(i2c, hdmarx, dma_rx);
+#endif
+}
+
+
+/**
+ * @brief HAL-called function on the end of a transmission.
+ *
+ * @param i2c: A HAL I2C_HandleTypeDef pointer to the I2C instance.
+ */
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *i2c) {
+
+    I2C_transfer_done(true);
+}
+
+
+/**
+ * @brief HAL-called function on the end of a register read.
+ *
+ * @param i2c: A HAL I2C_HandleTypeDef pointer to the I2C instance.
+ */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *i2c) {
+
+    I2C_transfer_done(true);
+}
+
+
+/**
+ * @brief HAL-called function on an I2C error, eg. a NACK.
+ *
+ * @param i2c: A HAL I2C_HandleTypeDef pointer to the I2C instance.
+ */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *i2c) {
+
+    I2C_transfer_done(false);
+}
+
+
+/**
+ * @brief I2C1 event ISR.
+ */
+void I2C1_EV_IRQHandler(void) {
+
+    HAL_I2C_EV_IRQHandler(&i2c);
+}
+
+
+/**
+ * @brief I2C1 error ISR.
+ */
+void I2C1_ER_IRQHandler(void) {
+
+    HAL_I2C_ER_IRQHandler(&i2c);
+}
+
+
+#if ENABLE_I2C_DMA == true
+/**
+ * @brief I2C1 transmit DMA channel ISR.
+ */
+void GPDMA1_Channel6_IRQHandler(void) {
+
+    HAL_DMA_IRQHandler(&dma_tx);
+}
+
+
+/**
+ * @brief I2C1 receive DMA channel ISR.
+ */
+void GPDMA1_Channel7_IRQHandler(void) {
+
+    HAL_DMA_IRQHandler(&dma_rx);
 }
+#endif
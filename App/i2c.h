@@ -15,6 +15,103 @@
  */
 #define     I2C_GPIO_BANK           GPIOB
 
+// I2C1 interrupts call FreeRTOS, so must be no more urgent
+// than `configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY`
+#define     I2C_IRQ_PRIORITY        6
+
+// With `ENABLE_I2C_DMA` set in the root `CMakeLists.txt`, transfers
+// of at least this many bytes use GPDMA channels, not interrupts
+#define     I2C_DMA_MIN_B           8
+#define     I2C_DMA_TX_CHANNEL      GPDMA1_Channel6
+#define     I2C_DMA_TX_IRQ          GPDMA1_Channel6_IRQn
+#define     I2C_DMA_RX_CHANNEL      GPDMA1_Channel7
+#define     I2C_DMA_RX_IRQ          GPDMA1_Channel7_IRQn
+
+// Transactions waiting for the bus. Low-priority writes may only
+// take `I2C_LOW_PRIORITY_MAX` of them, so there is always room
+// for a high-priority request
+#define     I2C_QUEUE_DEPTH         8
+#define     I2C_LOW_PRIORITY_MAX    4
+#define     I2C_QUEUE_TIMEOUT_MS    100
+
+// The largest write: a full HT16K33 frame
+#define     I2C_WRITE_MAX_B         17
+
+// A transfer that has not ended in this time is abandoned
+// and the peripheral reset
+#define     I2C_TRANSFER_TIMEOUT_MS 50
+
+// Thread flags: the bus manager's, and the one a reader waits on
+#define     I2C_FLAG_REQUEST        0x01
+#define     I2C_FLAG_TRANSFER_DONE  0x02
+#define     I2C_FLAG_READ_DONE      0x0100
+
+
+/*
+ * ENUMERATIONS
+ */
+// Requests are served highest priority first, then in order. Sensor
+// reads should be high priority, display writes low
+typedef enum {
+    I2C_PRIORITY_HIGH = 0,
+    I2C_PRIORITY_LOW,
+    I2C_PRIORITY_COUNT
+} I2CPriority;
+
+typedef enum {
+    I2C_REQUEST_FREE = 0,
+    I2C_REQUEST_CLAIMED,
+    I2C_REQUEST_QUEUED,
+    I2C_REQUEST_ACTIVE
+} I2CRequestState;
+
+
+/*
+ * STRUCTURES
+ */
+// Called from the bus manager task when a request ends
+typedef void (*I2CDone)(void* context, bool success);
+
+// A transaction: a write of `data`, or a read of `length` bytes
+// from register `reg` into `rx`
+typedef struct {
+    uint8_t     data[I2C_WRITE_MAX_B];
+    uint8_t     addr;
+    uint8_t     reg;
+    uint8_t     priority;
+    uint8_t     state;
+    bool        is_read;
+    bool        coalesce;
+    uint16_t    length;
+    uint8_t*    rx;
+    I2CDone     done;
+    void*       context;
+    uint32_t    sequence;
+    uint32_t    queued_cycles;
+} I2CRequest;
+
+// A task waiting for a read
+typedef struct {
+    osThreadId_t    thread;
+    volatile bool   success;
+} I2CReader;
+
+// Transfer counters since boot, and bus time since the last
+// `I2C_get_stats()` call. Times need the cycle counter.
+// `max_wait_us` is the longest any request waited for the
+// bus, by priority
+typedef struct {
+    uint32_t    transfers;
+    uint32_t    errors;
+    uint32_t    coalesced;
+    uint32_t    queue_waits;
+    uint32_t    dropped;
+    uint32_t    max_transfer_us;
+    uint32_t    max_wait_us[I2C_PRIORITY_COUNT];
+    uint32_t    busy_us;
+    uint32_t    period_ms;
+} I2CStats;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,6 +123,9 @@ extern "C" {
  */
 void I2C_init(void);
 void I2C_scan(void);
+bool I2C_write(uint8_t addr, const uint8_t* data, uint32_t length, I2CPriority priority, bool coalesce, I2CDone done, void* context);
+bool I2C_read(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t length);
+void I2C_get_stats(I2CStats* stats);
 
 
 #ifdef __cplusplus
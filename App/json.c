@@ -0,0 +1,690 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static bool     json_is_delimiter(char c);
+static int      json_primitive_type(const char* text, uint32_t length);
+static uint32_t json_scan_string(const char* text, uint32_t pos, uint32_t length);
+static uint32_t json_scan_spaces(const char* text, uint32_t pos, uint32_t length);
+static bool     json_get_decimal(const JsonDoc* doc, int32_t token, JsonDecimal* decimal);
+#if JSON_USE_SWAR == true
+static inline uint32_t json_swar_string_stops(uint32_t word);
+#endif
+#if ENABLE_JSON_BENCHMARK == true
+static void     json_benchmark_lookups(void);
+#endif
+
+
+/*
+ * GLOBALS
+ */
+// Powers of ten that doubles hold exactly
+static const double exact_powers[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/**
+ * @brief Split a JSON text into a flat array of tokens, in document order.
+ *
+ * No memory is allocated and nothing is copied: tokens record where each
+ * value lies in the text. Strings and numbers are only decoded when read.
+ * Object members are a key token followed by the value's tokens.
+ *
+ * @param doc:        The document to set up.
+ * @param text:       The JSON text. Parsing stops at a NUL.
+ * @param length:     The length of the text in bytes. Up to 64KB.
+ * @param tokens:     Storage for the tokens.
+ * @param max_tokens: The number of tokens `tokens` can hold.
+ *
+ * @returns The number of tokens, or a negative error, eg. `JSON_ERROR_NO_TOKENS`.
+ */
+int32_t json_parse(JsonDoc* doc, const char* text, uint32_t length, JsonToken* tokens, uint32_t max_tokens) {
+
+    doc->text = text;
+    doc->tokens = tokens;
+    doc->count = 0;
+    if (length > UINT16_MAX) return JSON_ERROR_INVALID;
+
+    // The indices of the objects and arrays still open
+    uint16_t open[JSON_MAX_DEPTH];
+    uint32_t depth = 0;
+    uint32_t count = 0;
+    uint32_t pos = 0;
+    uint32_t expect = JSON_EXPECT_VALUE;
+
+    while (pos < length && text[pos] != 0) {
+        char c = text[pos];
+        if (c == ' ') {
+            pos = json_scan_spaces(text, pos, length);
+            continue;
+        }
+
+        if (c == '\t' || c == '\r' || c == '\n') {
+            pos++;
+            continue;
+        }
+
+        if (c == ',') {
+            if (expect != JSON_EXPECT_COMMA_OR_CLOSE) return JSON_ERROR_INVALID;
+            expect = (tokens[open[depth - 1]].type == JSON_TYPE_OBJECT ? JSON_EXPECT_KEY : JSON_EXPECT_VALUE);
+            pos++;
+            continue;
+        }
+
+        if (c == ':') {
+            if (expect != JSON_EXPECT_COLON) return JSON_ERROR_INVALID;
+            expect = JSON_EXPECT_VALUE;
+            pos++;
+            continue;
+        }
+
+        if (c == '}' || c == ']') {
+            if (depth == 0) return JSON_ERROR_INVALID;
+            if (expect != JSON_EXPECT_COMMA_OR_CLOSE && expect != (c == '}' ? JSON_EXPECT_KEY_OR_CLOSE : JSON_EXPECT_VALUE_OR_CLOSE)) return JSON_ERROR_INVALID;
+            JsonToken* container = &tokens[open[--depth]];
+            if (container->type != (c == '}' ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY)) return JSON_ERROR_INVALID;
+            container->length = (uint16_t)(pos + 1 - container->start);
+            container->next = (uint16_t)count;
+            expect = (depth == 0 ? JSON_EXPECT_END : JSON_EXPECT_COMMA_OR_CLOSE);
+            pos++;
+            continue;
+        }
+
+        // Anything else starts a value, or a key if it's a string in an object
+        bool is_key = (expect == JSON_EXPECT_KEY || expect == JSON_EXPECT_KEY_OR_CLOSE);
+        if (is_key ? c != '"' : (expect != JSON_EXPECT_VALUE && expect != JSON_EXPECT_VALUE_OR_CLOSE)) return JSON_ERROR_INVALID;
+        if (count == max_tokens) return JSON_ERROR_NO_TOKENS;
+        JsonToken* token = &tokens[count];
+        token->reserved = 0;
+        token->next = (uint16_t)(count + 1);
+
+        if (c == '{' || c == '[') {
+            if (depth == JSON_MAX_DEPTH) return JSON_ERROR_INVALID;
+            token->type = (c == '{' ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY);
+            token->start = (uint16_t)pos;
+            token->length = 0;
+            open[depth++] = (uint16_t)count;
+            pos++;
+        } else if (c == '"') {
+            uint32_t start = ++pos;
+            while (true) {
+                pos = json_scan_string(text, pos, length);
+                if (pos >= length) return JSON_ERROR_PARTIAL;
+                if (text[pos] == '"') break;
+                if (text[pos] != '\\') return (text[pos] == 0 ? JSON_ERROR_PARTIAL : JSON_ERROR_INVALID);
+                pos += 2;
+            }
+
+            token->type = JSON_TYPE_STRING;
+            token->start = (uint16_t)start;
+            token->length = (uint16_t)(pos - start);
+            pos++;
+        } else {
+            uint32_t start = pos;
+            while (pos < length && !json_is_delimiter(text[pos])) pos++;
+            int type = json_primitive_type(&text[start], pos - start);
+            if (type == 0) return JSON_ERROR_INVALID;
+            token->type = (uint8_t)type;
+            token->start = (uint16_t)start;
+            token->length = (uint16_t)(pos - start);
+        }
+
+        if (is_key) {
+            expect = JSON_EXPECT_COLON;
+        } else if (token->type == JSON_TYPE_OBJECT) {
+            expect = JSON_EXPECT_KEY_OR_CLOSE;
+        } else if (token->type == JSON_TYPE_ARRAY) {
+            expect = JSON_EXPECT_VALUE_OR_CLOSE;
+        } else {
+            expect = (depth == 0 ? JSON_EXPECT_END : JSON_EXPECT_COMMA_OR_CLOSE);
+        }
+
+        count++;
+    }
+
+    if (depth > 0 || count == 0) return JSON_ERROR_PARTIAL;
+    doc->count = (int32_t)count;
+    return doc->count;
+}
+
+
+/**
+ * @brief Find an object member by key.
+ *
+ * Keys are compared as they appear in the text, without decoding escapes.
+ *
+ * @param doc:    The document.
+ * @param object: The object's token. May be negative, eg. a failed lookup.
+ * @param key:    The member's key.
+ *
+ * @returns The value's token, or -1 if there is no such member.
+ */
+int32_t json_find(const JsonDoc* doc, int32_t object, const char* key) {
+
+    if (json_type(doc, object) != JSON_TYPE_OBJECT) return -1;
+
+    int32_t end = doc->tokens[object].next;
+    int32_t token = object + 1;
+    while (token + 1 < end) {
+        if (json_string_equals(doc, token, key)) return token + 1;
+        token = doc->tokens[token + 1].next;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Get an array item.
+ *
+ * @param doc:   The document.
+ * @param array: The array's token. May be negative, eg. a failed lookup.
+ * @param index: The item's index.
+ *
+ * @returns The item's token, or -1 if there is no such item.
+ */
+int32_t json_array_get(const JsonDoc* doc, int32_t array, uint32_t index) {
+
+    if (json_type(doc, array) != JSON_TYPE_ARRAY) return -1;
+
+    int32_t end = doc->tokens[array].next;
+    int32_t token = array + 1;
+    while (token < end) {
+        if (index-- == 0) return token;
+        token = doc->tokens[token].next;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Get a token's type.
+ *
+ * @param doc:   The document.
+ * @param token: The token. May be negative, eg. a failed lookup.
+ *
+ * @returns The type, eg. `JSON_TYPE_STRING`, or 0 if there is no such token.
+ */
+uint8_t json_type(const JsonDoc* doc, int32_t token) {
+
+    if (token < 0 || token >= doc->count) return 0;
+    return doc->tokens[token].type;
+}
+
+
+/**
+ * @brief Compare a string value with a C string, without decoding it.
+ *
+ * @param doc:   The document.
+ * @param token: The string's token.
+ * @param value: The string to compare with.
+ *
+ * @returns `true` if the token is a string matching `value`, otherwise `false`.
+ */
+bool json_string_equals(const JsonDoc* doc, int32_t token, const char* value) {
+
+    if (json_type(doc, token) != JSON_TYPE_STRING) return false;
+
+    const JsonToken* string = &doc->tokens[token];
+    return (strncmp(&doc->text[string->start], value, string->length) == 0 && value[string->length] == 0);
+}
+
+
+/**
+ * @brief Decode a string value into a buffer.
+ *
+ * Escapes are decoded. `\u` escapes outside ASCII become '?'.
+ *
+ * @param doc:    The document.
+ * @param token:  The string's token.
+ * @param buffer: The buffer to write the string into.
+ * @param size:   The size of the buffer. The string is truncated to fit.
+ *
+ * @returns The length of the decoded string. Zero if the token is not a string.
+ */
+uint32_t json_get_string(const JsonDoc* doc, int32_t token, char* buffer, uint32_t size) {
+
+    if (size == 0) return 0;
+    buffer[0] = 0;
+    if (json_type(doc, token) != JSON_TYPE_STRING) return 0;
+
+    const char* text = &doc->text[doc->tokens[token].start];
+    uint32_t length = doc->tokens[token].length;
+    uint32_t written = 0;
+    for (uint32_t i = 0 ; i < length && written < size - 1 ; ++i) {
+        char c = text[i];
+        if (c == '\\' && i + 1 < length) {
+            c = text[++i];
+            switch (c) {
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case 'u': {
+                    unsigned code = 0;
+                    if (i + 4 < length && sscanf(&text[i + 1], "%4x", &code) == 1) i += 4;
+                    c = (code > 0 && code < 0x80) ? (char)code : '?';
+                    break;
+                }
+                default:
+                    // '"', '\\' and '/' stand for themselves
+                    break;
+            }
+        }
+
+        buffer[written++] = c;
+    }
+
+    buffer[written] = 0;
+    return written;
+}
+
+
+/**
+ * @brief Decode a number value.
+ *
+ * Numbers with a significand up to 2^53 and a power of ten up to 22
+ * either way -- which covers every number in a forecast -- are converted
+ * exactly with a single multiply or divide. Others fall back to `strtod()`.
+ *
+ * @param doc:   The document.
+ * @param token: The number's token.
+ * @param value: Where to write the number.
+ *
+ * @returns `true` if the token is a valid number, otherwise `false`.
+ */
+bool json_get_number(const JsonDoc* doc, int32_t token, double* value) {
+
+    JsonDecimal decimal;
+    if (!json_get_decimal(doc, token, &decimal)) return false;
+
+    // The significand and the power of ten are both exact doubles,
+    // so the one rounding step gives the correctly rounded result
+    if (!decimal.truncated && decimal.significand <= (1ULL << 53)
+        && decimal.exponent >= -22 && decimal.exponent <= 22) {
+        double result = (double)decimal.significand;
+        if (decimal.exponent < 0) {
+            result /= exact_powers[-decimal.exponent];
+        } else {
+            result *= exact_powers[decimal.exponent];
+        }
+
+        *value = decimal.negative ? -result : result;
+        return true;
+    }
+
+    // The text need not be NUL-terminated after the number
+    const JsonToken* number = &doc->tokens[token];
+    char digits[JSON_NUMBER_MAX_LEN_B] = { 0 };
+    if (number->length >= JSON_NUMBER_MAX_LEN_B) return false;
+    memcpy(digits, &doc->text[number->start], number->length);
+    *value = strtod(digits, NULL);
+    return true;
+}
+
+
+/**
+ * @brief Decode a number value as a fixed-point integer, without
+ *        using floating point.
+ *
+ * For example, with two decimals, 14.527 becomes 1453. Values are
+ * rounded half away from zero.
+ *
+ * @param doc:      The document.
+ * @param token:    The number's token.
+ * @param decimals: The number of decimal places to keep. Up to 9.
+ * @param value:    Where to write the number.
+ *
+ * @returns `true` if the token is a valid number that fits, otherwise `false`.
+ */
+bool json_get_fixed(const JsonDoc* doc, int32_t token, uint32_t decimals, int64_t* value) {
+
+    JsonDecimal decimal;
+    if (decimals > 9 || !json_get_decimal(doc, token, &decimal)) return false;
+
+    uint64_t result = decimal.significand;
+    int32_t shift = decimal.exponent + (int32_t)decimals;
+    if (shift > 0) {
+        for ( ; shift > 0 ; --shift) {
+            if (result > INT64_MAX / 10) return false;
+            result *= 10;
+        }
+    } else if (shift < 0) {
+        if (shift < -19) {
+            result = 0;
+        } else {
+            // Drop all but the last unwanted digit, then round on it
+            for ( ; shift < -1 ; ++shift) result /= 10;
+            uint32_t last = (uint32_t)(result % 10);
+            result = result / 10 + (last >= 5 ? 1 : 0);
+        }
+    }
+
+    // Unscaled and rounded values may still be out of range
+    if (result > INT64_MAX) return false;
+    *value = decimal.negative ? -(int64_t)result : (int64_t)result;
+    return true;
+}
+
+
+/**
+ * @brief Split a number value into a decimal significand and exponent.
+ *
+ * Only the first 19 significant digits are kept.
+ *
+ * @param doc:     The document.
+ * @param token:   The number's token.
+ * @param decimal: Where to write the parts.
+ *
+ * @returns `true` if the token is a valid JSON number, otherwise `false`.
+ */
+static bool json_get_decimal(const JsonDoc* doc, int32_t token, JsonDecimal* decimal) {
+
+    if (json_type(doc, token) != JSON_TYPE_NUMBER) return false;
+
+    const char* text = &doc->text[doc->tokens[token].start];
+    uint32_t length = doc->tokens[token].length;
+    uint32_t pos = 0;
+    memset(decimal, 0x00, sizeof(JsonDecimal));
+
+    if (text[pos] == '-') {
+        decimal->negative = true;
+        pos++;
+    }
+
+    // Integer part. Digits that don't fit raise the exponent instead
+    uint32_t digits = 0;
+    for ( ; pos < length && text[pos] >= '0' && text[pos] <= '9' ; ++pos, ++digits) {
+        if (decimal->significand < JSON_SIGNIFICAND_LIMIT) {
+            decimal->significand = decimal->significand * 10 + (uint32_t)(text[pos] - '0');
+        } else {
+            decimal->exponent++;
+            if (text[pos] != '0') decimal->truncated = true;
+        }
+    }
+
+    if (digits == 0) return false;
+
+    // Fractional part
+    if (pos < length && text[pos] == '.') {
+        digits = 0;
+        for (++pos ; pos < length && text[pos] >= '0' && text[pos] <= '9' ; ++pos, ++digits) {
+            if (decimal->significand < JSON_SIGNIFICAND_LIMIT) {
+                decimal->significand = decimal->significand * 10 + (uint32_t)(text[pos] - '0');
+                decimal->exponent--;
+            } else if (text[pos] != '0') {
+                decimal->truncated = true;
+            }
+        }
+
+        if (digits == 0) return false;
+    }
+
+    // Exponent, clamped well beyond the range of a double
+    if (pos < length && (text[pos] == 'e' || text[pos] == 'E')) {
+        bool negative = false;
+        int32_t exponent = 0;
+        pos++;
+        if (pos < length && (text[pos] == '-' || text[pos] == '+')) negative = (text[pos++] == '-');
+
+        digits = 0;
+        for ( ; pos < length && text[pos] >= '0' && text[pos] <= '9' ; ++pos, ++digits) {
+            if (exponent < 10000) exponent = exponent * 10 + (text[pos] - '0');
+        }
+
+        if (digits == 0) return false;
+        decimal->exponent += negative ? -exponent : exponent;
+    }
+
+    return (pos == length);
+}
+
+
+#if ENABLE_JSON_BENCHMARK == true
+/**
+ * @brief Time `json_parse()` over synthetic forecast payloads of
+ *        increasing size, and log its throughput.
+ *
+ * Uses 36KB of RAM. Build with `JSON_USE_SWAR` set to `false`
+ * to get the byte-at-a-time scanner's figures for comparison.
+ * Then times cJSON object lookups -- see `json_benchmark_lookups()`.
+ */
+void json_benchmark(void) {
+
+    static char text[JSON_BENCHMARK_MAX_SIZE_B];
+    static JsonToken tokens[JSON_BENCHMARK_MAX_TOKENS];
+    static const char item[] = "{\"dt\":1729267200,\"temp\":14.52,\"feels_like\":13.98,\"weather\":"
+                               "[{\"id\":803,\"main\":\"Clouds\",\"description\":\"broken clouds\",\"icon\":\"04d\"}]},";
+    const uint32_t item_length = sizeof(item) - 1;
+    bool use_cyccnt = diag_cycle_counter_start();
+
+    for (uint32_t size = 1024 ; size <= JSON_BENCHMARK_MAX_SIZE_B ; size *= 2) {
+        // Build an array of forecasts, replacing the last comma with a ']'
+        uint32_t length = 1;
+        text[0] = '[';
+        while (length + item_length <= size) {
+            memcpy(&text[length], item, item_length);
+            length += item_length;
+        }
+
+        text[length - 1] = ']';
+
+        JsonDoc doc;
+        int32_t count = 0;
+        uint32_t best = UINT32_MAX;
+        for (uint32_t i = 0 ; i < JSON_BENCHMARK_RUNS ; ++i) {
+            uint32_t start = use_cyccnt ? DWT->CYCCNT : HAL_GetTick();
+            count = json_parse(&doc, text, length, tokens, JSON_BENCHMARK_MAX_TOKENS);
+            uint32_t elapsed = (use_cyccnt ? DWT->CYCCNT : HAL_GetTick()) - start;
+            if (elapsed < best) best = elapsed;
+        }
+
+        if (best == 0) best = 1;
+        if (use_cyccnt) {
+            LOG_INFO("JSON %s: %lu B, %li tokens in %lu cycles, %lu.%03lu B/cycle",
+                     (JSON_USE_SWAR ? "SWAR" : "bytewise"), length, count, best,
+                     length / best, ((length % best) * 1000) / best);
+        } else {
+            LOG_INFO("JSON %s: %lu B, %li tokens in %lu ms",
+                     (JSON_USE_SWAR ? "SWAR" : "bytewise"), length, count, best);
+        }
+    }
+
+    json_benchmark_lookups();
+}
+
+
+/**
+ * @brief Time looking up every member of cJSON objects of increasing
+ *        size, by walking the member list and with the hashed key index.
+ *
+ * Objects smaller than `CJSON_INDEX_THRESHOLD` are never indexed, so
+ * both figures are for list walks. Lookups are too quick to time in ms,
+ * so this needs the cycle counter.
+ */
+static void json_benchmark_lookups(void) {
+
+    static char keys[JSON_BENCHMARK_MAX_KEYS][8];
+    volatile uintptr_t found = 0;
+
+    if (!diag_cycle_counter_start()) {
+        LOG_WARN("No cycle counter: cJSON lookups not timed");
+        return;
+    }
+
+    for (uint32_t size = 4 ; size <= JSON_BENCHMARK_MAX_KEYS ; size *= 2) {
+        cJSON* object = cJSON_CreateObject();
+        if (object == NULL) return;
+        for (uint32_t i = 0 ; i < size ; ++i) {
+            sprintf(keys[i], "key%lu", i);
+            cJSON_AddNumberToObject(object, keys[i], i);
+        }
+
+        // Walk the list, as cJSON does without an index
+        uint32_t start = DWT->CYCCNT;
+        for (uint32_t i = 0 ; i < size ; ++i) {
+            const cJSON* member = object->child;
+            while (member != NULL && strcmp(member->string, keys[i]) != 0) member = member->next;
+            found += (uintptr_t)member;
+        }
+
+        uint32_t walked = DWT->CYCCNT - start;
+
+        // Do one lookup that walks the whole list to build the index first
+        found += (uintptr_t)cJSON_GetObjectItemCaseSensitive(object, keys[size - 1]);
+        start = DWT->CYCCNT;
+        for (uint32_t i = 0 ; i < size ; ++i) {
+            found += (uintptr_t)cJSON_GetObjectItemCaseSensitive(object, keys[i]);
+        }
+
+        uint32_t indexed = DWT->CYCCNT - start;
+        LOG_INFO("cJSON lookup, %lu keys: %lu cycles walking, %lu indexed", size, walked / size, indexed / size);
+        cJSON_Delete(object);
+    }
+}
+#endif
+
+
+/**
+ * @brief Check whether a character ends a number or literal.
+ *
+ * @param c: The character.
+ *
+ * @returns `true` if the character is a delimiter, otherwise `false`.
+ */
+static bool json_is_delimiter(char c) {
+
+    return (c == ',' || c == ':' || c == '}' || c == ']' || c == '"' || c == '{' || c == '['
+            || c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == 0);
+}
+
+
+/**
+ * @brief Identify a number or literal.
+ *
+ * @param text:   The value's first character.
+ * @param length: The value's length.
+ *
+ * @returns The value's type, or 0 if it is not valid.
+ */
+static int json_primitive_type(const char* text, uint32_t length) {
+
+    if (length == 4 && strncmp(text, "true", 4) == 0) return JSON_TYPE_TRUE;
+    if (length == 5 && strncmp(text, "false", 5) == 0) return JSON_TYPE_FALSE;
+    if (length == 4 && strncmp(text, "null", 4) == 0) return JSON_TYPE_NULL;
+    if (length == 0 || (text[0] != '-' && (text[0] < '0' || text[0] > '9'))) return 0;
+
+    for (uint32_t i = 1 ; i < length ; ++i) {
+        char c = text[i];
+        if ((c < '0' || c > '9') && c != '.' && c != 'e' && c != 'E' && c != '+' && c != '-') return 0;
+    }
+
+    return JSON_TYPE_NUMBER;
+}
+
+
+/**
+ * @brief Find the end of a run of string characters: the first quote,
+ *        backslash or control character.
+ *
+ * @param text:   The JSON text.
+ * @param pos:    Where to start.
+ * @param length: The length of the text.
+ *
+ * @returns The position of the character, or `length` if there is none.
+ */
+static uint32_t json_scan_string(const char* text, uint32_t pos, uint32_t length) {
+
+#if JSON_USE_SWAR == true
+    // Skip eight bytes at a time until a word holds a stop character
+    while (pos + 8 <= length) {
+        uint32_t words[2];
+        memcpy(words, &text[pos], 8);
+        if ((json_swar_string_stops(words[0]) | json_swar_string_stops(words[1])) != 0) break;
+        pos += 8;
+    }
+#endif
+
+    // Find the exact position
+    while (pos < length) {
+        uint8_t c = (uint8_t)text[pos];
+        if (c == '"' || c == '\\' || c < 0x20) break;
+        pos++;
+    }
+
+    return pos;
+}
+
+
+/**
+ * @brief Skip a run of spaces, such as indentation.
+ *
+ * @param text:   The JSON text.
+ * @param pos:    The position of the first space.
+ * @param length: The length of the text.
+ *
+ * @returns The position of the first character that is not a space.
+ */
+static uint32_t json_scan_spaces(const char* text, uint32_t pos, uint32_t length) {
+
+#if JSON_USE_SWAR == true
+    while (pos + 4 <= length) {
+        uint32_t word;
+        memcpy(&word, &text[pos], 4);
+        if (word != 0x20202020) break;
+        pos += 4;
+    }
+#endif
+
+    while (pos < length && text[pos] == ' ') pos++;
+    return pos;
+}
+
+
+#if JSON_USE_SWAR == true
+/**
+ * @brief Check four bytes of a string at once for a quote,
+ *        backslash or control character.
+ *
+ * On cores with the DSP extension, `USUB8` compares each byte
+ * and `SEL` turns the result into a byte mask. Otherwise, the
+ * classic SWAR bit tricks are used: these may flag extra bytes
+ * after a real match, but never miss one.
+ *
+ * @param word: Four bytes of the text.
+ *
+ * @returns Zero if none of the bytes is a stop character.
+ */
+static inline uint32_t json_swar_string_stops(uint32_t word) {
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP == 1
+    // Each mask byte is 0xFF where the byte is >= the limit's byte
+    uint32_t printable, not_quote, not_backslash;
+    __asm ("usub8 %0, %1, %2\n\tsel %0, %3, %4" : "=&r" (printable) : "r" (word), "r" (0x20202020), "r" (0xFFFFFFFF), "r" (0) : "cc");
+    __asm ("usub8 %0, %1, %2\n\tsel %0, %3, %4" : "=&r" (not_quote) : "r" (word ^ 0x22222222), "r" (0x01010101), "r" (0xFFFFFFFF), "r" (0) : "cc");
+    __asm ("usub8 %0, %1, %2\n\tsel %0, %3, %4" : "=&r" (not_backslash) : "r" (word ^ 0x5C5C5C5C), "r" (0x01010101), "r" (0xFFFFFFFF), "r" (0) : "cc");
+    return ~(printable & not_quote & not_backslash);
+#else
+    // A byte's top bit is set if it was zero after the XOR, or below 0x20
+    uint32_t quote = word ^ 0x22222222;
+    uint32_t backslash = word ^ 0x5C5C5C5C;
+    return (((quote - 0x01010101) & ~quote)
+            | ((backslash - 0x01010101) & ~backslash)
+            | ((word - 0x20202020) & ~word)) & 0x80808080;
+#endif
+}
+#endif
@@ -0,0 +1,118 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _JSON_H_
+#define _JSON_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Token types
+#define     JSON_TYPE_OBJECT                1
+#define     JSON_TYPE_ARRAY                 2
+#define     JSON_TYPE_STRING                3
+#define     JSON_TYPE_NUMBER                4
+#define     JSON_TYPE_TRUE                  5
+#define     JSON_TYPE_FALSE                 6
+#define     JSON_TYPE_NULL                  7
+
+// `json_parse()` errors
+#define     JSON_ERROR_NO_TOKENS            -1      // The token array is too small
+#define     JSON_ERROR_INVALID              -2      // The text is not valid JSON
+#define     JSON_ERROR_PARTIAL              -3      // The text ends mid-value
+
+// What `json_parse()` will accept next
+#define     JSON_EXPECT_VALUE               0
+#define     JSON_EXPECT_VALUE_OR_CLOSE      1       // After `[`
+#define     JSON_EXPECT_KEY                 2       // After `,` in an object
+#define     JSON_EXPECT_KEY_OR_CLOSE        3       // After `{`
+#define     JSON_EXPECT_COLON               4
+#define     JSON_EXPECT_COMMA_OR_CLOSE      5
+#define     JSON_EXPECT_END                 6       // After the top-level value
+
+// Maximum nesting of objects and arrays
+#define     JSON_MAX_DEPTH                  16
+
+// Longest number `json_get_number()` will pass to `strtod()`
+// when it can't convert it exactly itself
+#define     JSON_NUMBER_MAX_LEN_B           32
+
+// Significands are accumulated up to 19 digits
+#define     JSON_SIGNIFICAND_LIMIT          1000000000000000000ULL
+
+// Scan strings and space runs a word at a time. Set false for the
+// byte-at-a-time scanner, eg. to compare the two with the JSON benchmark
+#ifndef     JSON_USE_SWAR
+#define     JSON_USE_SWAR                   true
+#endif
+
+// The benchmark parses payloads from 1KB, doubling up to the max. size,
+// and keeps the fastest of several runs. Enabled in the root `CMakeLists.txt`
+#define     JSON_BENCHMARK_MAX_SIZE_B       16384
+#define     JSON_BENCHMARK_MAX_TOKENS       2560
+#define     JSON_BENCHMARK_RUNS             8
+#define     JSON_BENCHMARK_MAX_KEYS         128
+
+
+/*
+ * STRUCTURES
+ */
+// A value in the text. Strings exclude their quotes. `next` is the
+// index of the token after the value and everything inside it
+typedef struct {
+    uint8_t     type;
+    uint8_t     reserved;
+    uint16_t    next;
+    uint16_t    start;
+    uint16_t    length;
+} JsonToken;
+
+// A number value split into its parts. `truncated` is set if
+// non-zero digits were dropped from the significand
+typedef struct {
+    uint64_t    significand;
+    int32_t     exponent;
+    bool        negative;
+    bool        truncated;
+} JsonDecimal;
+
+// A tokenized JSON text. Neither the text nor the tokens are copied,
+// so both must outlive it
+typedef struct {
+    const char* text;
+    JsonToken*  tokens;
+    int32_t     count;
+} JsonDoc;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+int32_t     json_parse(JsonDoc* doc, const char* text, uint32_t length, JsonToken* tokens, uint32_t max_tokens);
+int32_t     json_find(const JsonDoc* doc, int32_t object, const char* key);
+int32_t     json_array_get(const JsonDoc* doc, int32_t array, uint32_t index);
+uint8_t     json_type(const JsonDoc* doc, int32_t token);
+bool        json_string_equals(const JsonDoc* doc, int32_t token, const char* value);
+uint32_t    json_get_string(const JsonDoc* doc, int32_t token, char* buffer, uint32_t size);
+bool        json_get_number(const JsonDoc* doc, int32_t token, double* value);
+bool        json_get_fixed(const JsonDoc* doc, int32_t token, uint32_t decimals, int64_t* value);
+void        json_benchmark(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _JSON_H_
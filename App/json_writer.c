@@ -0,0 +1,382 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     json_writer_put(JsonWriter* writer, const char* data, uint32_t length);
+static void     json_writer_put_string(JsonWriter* writer, const char* value);
+static void     json_writer_prefix(JsonWriter* writer, const char* key);
+static void     json_writer_open(JsonWriter* writer, const char* key, const char* bracket);
+static void     json_writer_close(JsonWriter* writer, const char* bracket);
+static uint32_t json_writer_format(char* digits, uint64_t value, uint32_t min_digits);
+
+
+/**
+ * @brief Set up a writer to serialise JSON into a buffer.
+ *
+ * Values are written straight into the buffer as they are added:
+ * nothing is allocated. The text is always NUL-terminated.
+ *
+ * @param writer:  The writer.
+ * @param buffer:  The buffer to write into.
+ * @param size:    The size of the buffer. At least 2 bytes.
+ * @param flush:   A function to pass on the text each time the buffer
+ *                 fills, so that it can be reused, or `NULL`. Without
+ *                 one, running out of room is an overflow.
+ * @param context: A value to pass to `flush`.
+ */
+void json_writer_init(JsonWriter* writer, char* buffer, uint32_t size, JsonFlush flush, void* context) {
+
+    memset(writer, 0x00, sizeof(JsonWriter));
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->flush = flush;
+    writer->context = context;
+    writer->overflow = (buffer == NULL || size < 2);
+    if (!writer->overflow) buffer[0] = 0;
+}
+
+
+/**
+ * @brief Complete the text, passing any remainder to the flush function.
+ *
+ * @param writer: The writer.
+ *
+ * @returns The total length of the text, or -1 if it overflowed,
+ *          a flush failed or an object or array was left open.
+ */
+int32_t json_writer_finish(JsonWriter* writer) {
+
+    if (writer->overflow || writer->depth != 0) return -1;
+
+    if (writer->flush != NULL && writer->length > 0) {
+        if (!writer->flush(writer->context, writer->buffer, writer->length)) return -1;
+        writer->length = 0;
+        writer->buffer[0] = 0;
+    }
+
+    return (int32_t)writer->total;
+}
+
+
+/**
+ * @brief Start an object.
+ *
+ * @param writer: The writer.
+ * @param key:    The object's key, or `NULL` in an array or at the top level.
+ */
+void json_write_object_begin(JsonWriter* writer, const char* key) {
+
+    json_writer_open(writer, key, "{");
+}
+
+
+/**
+ * @brief End the current object.
+ *
+ * @param writer: The writer.
+ */
+void json_write_object_end(JsonWriter* writer) {
+
+    json_writer_close(writer, "}");
+}
+
+
+/**
+ * @brief Start an array.
+ *
+ * @param writer: The writer.
+ * @param key:    The array's key, or `NULL` in an array or at the top level.
+ */
+void json_write_array_begin(JsonWriter* writer, const char* key) {
+
+    json_writer_open(writer, key, "[");
+}
+
+
+/**
+ * @brief End the current array.
+ *
+ * @param writer: The writer.
+ */
+void json_write_array_end(JsonWriter* writer) {
+
+    json_writer_close(writer, "]");
+}
+
+
+/**
+ * @brief Write a string value, escaping it as needed.
+ *
+ * @param writer: The writer.
+ * @param key:    The value's key, or `NULL` in an array.
+ * @param value:  The string.
+ */
+void json_write_string(JsonWriter* writer, const char* key, const char* value) {
+
+    json_writer_prefix(writer, key);
+    json_writer_put_string(writer, value);
+}
+
+
+/**
+ * @brief Write an integer value.
+ *
+ * @param writer: The writer.
+ * @param key:    The value's key, or `NULL` in an array.
+ * @param value:  The integer.
+ */
+void json_write_int(JsonWriter* writer, const char* key, int64_t value) {
+
+    json_write_fixed(writer, key, value, 0);
+}
+
+
+/**
+ * @brief Write a fixed-point value, without using floating point.
+ *
+ * For example, 1453 with two decimals is written as `14.53`.
+ *
+ * @param writer:   The writer.
+ * @param key:      The value's key, or `NULL` in an array.
+ * @param value:    The value, scaled by 10^decimals.
+ * @param decimals: The number of decimal places. Up to 9.
+ */
+void json_write_fixed(JsonWriter* writer, const char* key, int64_t value, uint32_t decimals) {
+
+    // Sign, 20 digits, point and NUL
+    char text[24] = { 0 };
+    uint32_t length = 0;
+    if (decimals > 9) decimals = 9;
+
+    uint64_t magnitude = (uint64_t)value;
+    if (value < 0) {
+        text[length++] = '-';
+        magnitude = 0 - magnitude;
+    }
+
+    char digits[21];
+    uint32_t count = json_writer_format(digits, magnitude, decimals + 1);
+    memcpy(&text[length], digits, count - decimals);
+    length += count - decimals;
+    if (decimals > 0) {
+        text[length++] = '.';
+        memcpy(&text[length], &digits[count - decimals], decimals);
+        length += decimals;
+    }
+
+    json_writer_prefix(writer, key);
+    json_writer_put(writer, text, length);
+}
+
+
+/**
+ * @brief Write a boolean value.
+ *
+ * @param writer: The writer.
+ * @param key:    The value's key, or `NULL` in an array.
+ * @param value:  The boolean.
+ */
+void json_write_bool(JsonWriter* writer, const char* key, bool value) {
+
+    json_writer_prefix(writer, key);
+    if (value) {
+        json_writer_put(writer, "true", 4);
+    } else {
+        json_writer_put(writer, "false", 5);
+    }
+}
+
+
+/**
+ * @brief Write a null value.
+ *
+ * @param writer: The writer.
+ * @param key:    The value's key, or `NULL` in an array.
+ */
+void json_write_null(JsonWriter* writer, const char* key) {
+
+    json_writer_prefix(writer, key);
+    json_writer_put(writer, "null", 4);
+}
+
+
+/**
+ * @brief Append text to the buffer, flushing it whenever it fills.
+ *
+ * @param writer: The writer.
+ * @param data:   The text.
+ * @param length: The length of the text.
+ */
+static void json_writer_put(JsonWriter* writer, const char* data, uint32_t length) {
+
+    while (length > 0 && !writer->overflow) {
+        // Keep a byte for the NUL
+        uint32_t space = writer->size - 1 - writer->length;
+        if (space == 0) {
+            if (writer->flush == NULL || !writer->flush(writer->context, writer->buffer, writer->length)) {
+                writer->overflow = true;
+                break;
+            }
+
+            writer->length = 0;
+            continue;
+        }
+
+        uint32_t count = length < space ? length : space;
+        memcpy(&writer->buffer[writer->length], data, count);
+        writer->length += count;
+        writer->total += count;
+        data += count;
+        length -= count;
+    }
+
+    // No buffer to terminate if `json_writer_init()` was given none
+    if (writer->buffer != NULL && writer->size > 0) writer->buffer[writer->length] = 0;
+}
+
+
+/**
+ * @brief Append a quoted string, escaping quotes, backslashes and
+ *        control characters. Runs of plain characters are copied whole.
+ *
+ * @param writer: The writer.
+ * @param value:  The string.
+ */
+static void json_writer_put_string(JsonWriter* writer, const char* value) {
+
+    static const char hex[] = "0123456789abcdef";
+
+    json_writer_put(writer, "\"", 1);
+    if (value == NULL) value = "";
+
+    const char* run = value;
+    for ( ; *value != 0 ; ++value) {
+        uint8_t c = (uint8_t)*value;
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+
+        json_writer_put(writer, run, (uint32_t)(value - run));
+        run = value + 1;
+
+        char escape[6] = { '\\', (char)c, 0, 0, 0, 0 };
+        uint32_t length = 2;
+        switch (c) {
+            case '"':
+            case '\\':
+                break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            default:
+                memcpy(&escape[1], "u00", 3);
+                escape[4] = hex[c >> 4];
+                escape[5] = hex[c & 0x0F];
+                length = 6;
+        }
+
+        json_writer_put(writer, escape, length);
+    }
+
+    json_writer_put(writer, run, (uint32_t)(value - run));
+    json_writer_put(writer, "\"", 1);
+}
+
+
+/**
+ * @brief Write what comes before a value: a comma if it's not the first
+ *        at its level, and its key if it has one.
+ *
+ * @param writer: The writer.
+ * @param key:    The value's key, or `NULL`.
+ */
+static void json_writer_prefix(JsonWriter* writer, const char* key) {
+
+    uint32_t level = 1UL << writer->depth;
+    if (writer->comma & level) json_writer_put(writer, ",", 1);
+    writer->comma |= level;
+
+    if (key != NULL) {
+        json_writer_put_string(writer, key);
+        json_writer_put(writer, ":", 1);
+    }
+}
+
+
+/**
+ * @brief Start an object or array.
+ *
+ * @param writer:  The writer.
+ * @param key:     The value's key, or `NULL`.
+ * @param bracket: The opening bracket.
+ */
+static void json_writer_open(JsonWriter* writer, const char* key, const char* bracket) {
+
+    if (writer->depth == JSON_WRITER_MAX_DEPTH) {
+        writer->overflow = true;
+        return;
+    }
+
+    json_writer_prefix(writer, key);
+    json_writer_put(writer, bracket, 1);
+    writer->depth++;
+    writer->comma &= ~(1UL << writer->depth);
+    if (bracket[0] == '[') {
+        writer->array |= (1UL << writer->depth);
+    } else {
+        writer->array &= ~(1UL << writer->depth);
+    }
+}
+
+
+/**
+ * @brief End an object or array. Ending one that isn't open, or
+ *        ending an object as an array or vice versa, is an overflow.
+ *
+ * @param writer:  The writer.
+ * @param bracket: The closing bracket.
+ */
+static void json_writer_close(JsonWriter* writer, const char* bracket) {
+
+    bool is_array = (writer->array & (1UL << writer->depth)) != 0;
+    if (writer->depth == 0 || is_array != (bracket[0] == ']')) {
+        writer->overflow = true;
+        return;
+    }
+
+    writer->depth--;
+    json_writer_put(writer, bracket, 1);
+}
+
+
+/**
+ * @brief Format an unsigned integer as decimal digits, without `printf()`.
+ *
+ * @param digits:     At least 21 bytes to write the digits into. Not NUL-terminated.
+ * @param value:      The integer.
+ * @param min_digits: The least number of digits to write, padding with leading zeros.
+ *
+ * @returns The number of digits written.
+ */
+static uint32_t json_writer_format(char* digits, uint64_t value, uint32_t min_digits) {
+
+    char reversed[20];
+    uint32_t count = 0;
+    do {
+        reversed[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (count < min_digits) reversed[count++] = '0';
+
+    for (uint32_t i = 0 ; i < count ; ++i) digits[i] = reversed[count - 1 - i];
+    return count;
+}
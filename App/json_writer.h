@@ -0,0 +1,70 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _JSON_WRITER_H_
+#define _JSON_WRITER_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Maximum nesting of objects and arrays
+#define     JSON_WRITER_MAX_DEPTH           16
+
+
+/*
+ * STRUCTURES
+ */
+// Called when the buffer is full, and by `json_writer_finish()`, to pass
+// on the text so far. Return `false` to stop writing
+typedef bool (*JsonFlush)(void* context, const char* data, uint32_t length);
+
+// Writer state. `comma` has a bit per nesting level, set once
+// that level has a value, so that the next is preceded by a comma.
+// `array` has a bit per level, set if the level is an array
+typedef struct {
+    char*       buffer;
+    uint32_t    size;
+    uint32_t    length;
+    uint32_t    total;
+    uint32_t    depth;
+    uint32_t    comma;
+    uint32_t    array;
+    bool        overflow;
+    JsonFlush   flush;
+    void*       context;
+} JsonWriter;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        json_writer_init(JsonWriter* writer, char* buffer, uint32_t size, JsonFlush flush, void* context);
+int32_t     json_writer_finish(JsonWriter* writer);
+void        json_write_object_begin(JsonWriter* writer, const char* key);
+void        json_write_object_end(JsonWriter* writer);
+void        json_write_array_begin(JsonWriter* writer, const char* key);
+void        json_write_array_end(JsonWriter* writer);
+void        json_write_string(JsonWriter* writer, const char* key, const char* value);
+void        json_write_int(JsonWriter* writer, const char* key, int64_t value);
+void        json_write_fixed(JsonWriter* writer, const char* key, int64_t value, uint32_t decimals);
+void        json_write_bool(JsonWriter* writer, const char* key, bool value);
+void        json_write_null(JsonWriter* writer, const char* key);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _JSON_WRITER_H_
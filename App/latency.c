@@ -0,0 +1,165 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     latency_complete(uint32_t location);
+static uint32_t latency_bucket_index(uint32_t ms);
+static uint32_t latency_bucket_floor(uint32_t index);
+static uint32_t latency_percentile(const uint16_t *buckets, uint32_t count, uint32_t percent);
+
+
+/*
+ * GLOBALS
+ */
+// Stage timestamps for each location's forecast in progress. Stages are
+// marked from `task_iot`, `task_led`, the forecast task and the shared NC ISR
+static volatile uint32_t stage_ticks[LOCATION_MAX][LATENCY_STAGE_COUNT] = { 0 };
+static volatile uint32_t stages_seen[LOCATION_MAX] = { 0 };
+static volatile uint32_t current_location = 0;
+
+// One histogram per stage of the time since the request was issued
+static uint16_t histograms[LATENCY_STAGE_COUNT][LATENCY_BUCKET_COUNT] = { 0 };
+static uint32_t sample_counts[LATENCY_STAGE_COUNT] = { 0 };
+static uint32_t forecasts_started = 0;
+static uint32_t forecasts_completed = 0;
+
+static const char *stage_names[LATENCY_STAGE_COUNT] = {
+    "request", "readable", "body", "parsed", "published", "drawn"
+};
+
+
+/**
+ * @brief Record that a location's forecast has reached a stage.
+ *
+ * Marking `LATENCY_STAGE_REQUEST` starts timing a new forecast for the
+ * location, and makes it the current location. Later stages are ignored
+ * if the forecast did not reach the previous stage. Safe to call from
+ * the shared NC ISR.
+ *
+ * @param location: The location's index, or `LATENCY_LOCATION_CURRENT`.
+ * @param stage:    The stage reached, eg. `LATENCY_STAGE_BODY_READ`.
+ */
+void latency_mark(uint32_t location, uint32_t stage) {
+
+    if (location == LATENCY_LOCATION_CURRENT) location = current_location;
+    if (stage >= LATENCY_STAGE_COUNT || location >= LOCATION_MAX) return;
+
+    if (stage == LATENCY_STAGE_REQUEST) {
+        stage_ticks[location][stage] = HAL_GetTick();
+        stages_seen[location] = 1;
+        current_location = location;
+        forecasts_started++;
+        return;
+    }
+
+    // Only accept the next stage in sequence
+    if (stages_seen[location] != (1UL << stage) - 1) return;
+    stage_ticks[location][stage] = HAL_GetTick();
+    stages_seen[location] |= (1UL << stage);
+
+    if (stage == LATENCY_STAGE_FIRST_DRAW) latency_complete(location);
+}
+
+
+/**
+ * @brief Log the estimated p50 and p99 time from request to each stage.
+ *
+ * Values are bucket upper bounds, so are accurate to within ~19%.
+ */
+void latency_report(void) {
+
+    LOG_INFO("Forecast latency: %lu of %lu forecasts completed", forecasts_completed, forecasts_started);
+    for (uint32_t i = 1 ; i < LATENCY_STAGE_COUNT ; ++i) {
+        if (sample_counts[i] == 0) continue;
+        LOG_INFO("  to %-9s n=%lu p50<=%lums p99<=%lums",
+                 stage_names[i],
+                 sample_counts[i],
+                 latency_percentile(histograms[i], sample_counts[i], 50),
+                 latency_percentile(histograms[i], sample_counts[i], 99));
+    }
+}
+
+
+/**
+ * @brief Add a completed forecast's stage times to the histograms,
+ *        and report every `LATENCY_REPORT_EVERY` forecasts.
+ *
+ * @param location: The location's index.
+ */
+static void latency_complete(uint32_t location) {
+
+    for (uint32_t i = 1 ; i < LATENCY_STAGE_COUNT ; ++i) {
+        uint32_t index = latency_bucket_index(stage_ticks[location][i] - stage_ticks[location][LATENCY_STAGE_REQUEST]);
+        if (histograms[i][index] < UINT16_MAX) histograms[i][index]++;
+        sample_counts[i]++;
+    }
+
+    forecasts_completed++;
+    if (forecasts_completed % LATENCY_REPORT_EVERY == 0) latency_report();
+}
+
+
+/**
+ * @brief Map a latency to its histogram bucket.
+ *
+ * Values below 4ms get a bucket each. Above that, each power of two
+ * is split into four equal buckets, keyed by the two bits below the MSB.
+ *
+ * @param ms: The latency in ms.
+ *
+ * @returns The bucket index.
+ */
+static uint32_t latency_bucket_index(uint32_t ms) {
+
+    if (ms < 4) return ms;
+
+    uint32_t msb = 31 - __builtin_clz(ms);
+    uint32_t index = (msb - 1) * 4 + ((ms >> (msb - 2)) & 0x03);
+    return index < LATENCY_BUCKET_COUNT ? index : LATENCY_BUCKET_COUNT - 1;
+}
+
+
+/**
+ * @brief Get the lowest latency that maps to a bucket.
+ *
+ * @param index: The bucket index.
+ *
+ * @returns The latency in ms.
+ */
+static uint32_t latency_bucket_floor(uint32_t index) {
+
+    if (index < 4) return index;
+    return (4 + (index & 0x03)) << (index / 4 - 1);
+}
+
+
+/**
+ * @brief Estimate a percentile from a histogram.
+ *
+ * @param buckets: The histogram.
+ * @param count:   The number of samples in the histogram.
+ * @param percent: The percentile, eg. 99.
+ *
+ * @returns The upper bound, in ms, of the bucket holding the percentile.
+ */
+static uint32_t latency_percentile(const uint16_t *buckets, uint32_t count, uint32_t percent) {
+
+    uint32_t target = (count * percent + 99) / 100;
+    uint32_t total = 0;
+    for (uint32_t i = 0 ; i < LATENCY_BUCKET_COUNT ; ++i) {
+        total += buckets[i];
+        if (total >= target) return latency_bucket_floor(i + 1);
+    }
+
+    return latency_bucket_floor(LATENCY_BUCKET_COUNT);
+}
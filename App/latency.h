@@ -0,0 +1,52 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Forecast stages, in the order they occur. Each location's
+// forecast is timed separately
+#define     LATENCY_STAGE_REQUEST           0   // `OW_request_forecast()` issued
+#define     LATENCY_STAGE_DATA_READABLE     1   // Channel data readable notification
+#define     LATENCY_STAGE_BODY_READ         2   // `mvReadHttpResponseBody()` completed
+#define     LATENCY_STAGE_PARSED            3   // JSON parsed and classified
+#define     LATENCY_STAGE_PUBLISHED         4   // `forecast_publish()` completed
+#define     LATENCY_STAGE_FIRST_DRAW        5   // Display first refreshed after taking it
+#define     LATENCY_STAGE_COUNT             6
+
+// Marks the location whose request is outstanding, for the NC ISR
+#define     LATENCY_LOCATION_CURRENT        0xFF
+
+// Histogram buckets are log scale: four per doubling of the
+// latency in ms, so 64 buckets cover up to ~131s
+#define     LATENCY_BUCKET_COUNT            64
+#define     LATENCY_REPORT_EVERY            12
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        latency_mark(uint32_t location, uint32_t stage);
+void        latency_report(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _LATENCY_H_
@@ -0,0 +1,132 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * GLOBALS
+ */
+// The location table. `locations_used` is only raised once an
+// entry is complete, so `task_led` can read the table at any time
+static Location locations[LOCATION_MAX] = { 0 };
+static volatile uint32_t locations_used = 0;
+
+
+/**
+ * @brief Load the forecast locations from the config store.
+ *
+ * Items are read in order from `location-1`, stopping at the first
+ * that is missing. If none can be read, the default location is used.
+ *
+ * @param default_lat: The default location's latitude.
+ * @param default_lng: The default location's longitude.
+ */
+void location_configure(double default_lat, double default_lng) {
+
+    uint32_t count = 0;
+    for (uint32_t i = 0 ; i < LOCATION_MAX ; ++i) {
+        char key[16] = { 0 };
+        char value[65] = { 0 };
+        sprintf(key, "%s%lu", LOCATION_CONFIG_KEY_PREFIX, i + 1);
+        if (!config_get_value(value, key)) break;
+
+        // Long names are truncated to fit
+        char name[65] = { 0 };
+        double lat = 0.0;
+        double lng = 0.0;
+        if (sscanf(value, "%64[^,],%lf,%lf", name, &lat, &lng) == 3
+            && lat >= -90.0 && lat <= 90.0 && lng >= -180.0 && lng <= 180.0) {
+            Location* location = &locations[count];
+            memset(location, 0x00, sizeof(Location));
+            strncpy(location->name, name, LOCATION_NAME_LEN_B - 1);
+            location->latitude = (float)lat;
+            location->longitude = (float)lng;
+            location->icon_code = NONE;
+            locations_used = ++count;
+        } else {
+            LOG_WARN("Unknown location '%s'", value);
+        }
+    }
+
+    if (count == 0) {
+        memset(&locations[0], 0x00, sizeof(Location));
+        locations[0].latitude = (float)default_lat;
+        locations[0].longitude = (float)default_lng;
+        locations[0].icon_code = NONE;
+        locations_used = 1;
+    }
+
+    LOG_INFO("Forecast locations: %lu (%u B each)", locations_used, sizeof(Location));
+}
+
+
+/**
+ * @brief Get the number of forecast locations.
+ *
+ * @returns The number of locations. Zero until `location_configure()` is called.
+ */
+uint32_t location_count(void) {
+
+    return locations_used;
+}
+
+
+/**
+ * @brief Get a forecast location.
+ *
+ * @param index: The location's index.
+ *
+ * @returns The location, or `NULL` if there is no such location.
+ */
+const Location* location_get(uint32_t index) {
+
+    if (index >= locations_used) return NULL;
+    return &locations[index];
+}
+
+
+/**
+ * @brief Find the next location, after the given one, which has a forecast.
+ *
+ * @param index: The current location's index.
+ *
+ * @returns The next location's index, or `index` if no other has a forecast.
+ */
+uint32_t location_next(uint32_t index) {
+
+    uint32_t count = locations_used;
+    for (uint32_t i = 1 ; i < count ; ++i) {
+        uint32_t next = (index + i) % count;
+        if (locations[next].timestamp != 0) return next;
+    }
+
+    return index;
+}
+
+
+/**
+ * @brief Store a location's latest forecast.
+ *
+ * @param index:       The location's index.
+ * @param icon_code:   The forecast's icon, eg. `RAIN`.
+ * @param label:       The forecast description, eg. "Rain".
+ * @param temperature: The forecast's temperature.
+ * @param timestamp:   The forecast's time, in Unix epoch seconds.
+ */
+void location_set_forecast(uint32_t index, uint32_t icon_code, const char* label, double temperature, uint32_t timestamp) {
+
+    if (index >= locations_used) return;
+
+    Location* location = &locations[index];
+    location->icon_code = (uint8_t)icon_code;
+    location->temperature = (int16_t)(temperature * 10.0 + (temperature < 0.0 ? -0.5 : 0.5));
+    strncpy(location->label, label, LOCATION_LABEL_LEN_B - 1);
+    location->label[LOCATION_LABEL_LEN_B - 1] = 0;
+    location->timestamp = timestamp != 0 ? timestamp : 1;
+}
@@ -0,0 +1,65 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _LOCATION_H_
+#define _LOCATION_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Forecast locations are read at startup from the per-device config
+// items `location-1` to `location-<LOCATION_MAX>`, each with the value
+// `<name>,<latitude>,<longitude>`. Without them, the single location
+// set by `LATITUDE` and `LONGITUDE` is used
+#define     LOCATION_MAX                    8
+#define     LOCATION_CONFIG_KEY_PREFIX      "location-"
+#define     LOCATION_NAME_LEN_B             12
+#define     LOCATION_LABEL_LEN_B            14
+
+// How long each location's forecast is shown when there are several
+#define     LOCATION_ROTATE_PERIOD_MS       15000
+
+
+/*
+ * STRUCTURES
+ */
+// One location and its latest forecast. A zero timestamp means
+// no forecast has been received yet
+typedef struct {
+    char        name[LOCATION_NAME_LEN_B];
+    float       latitude;
+    float       longitude;
+    uint32_t    timestamp;
+    int16_t     temperature;                    // Tenths of a degree C
+    uint8_t     icon_code;
+    char        label[LOCATION_LABEL_LEN_B];
+} Location;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void            location_configure(double default_lat, double default_lng);
+uint32_t        location_count(void);
+const Location* location_get(uint32_t index);
+uint32_t        location_next(uint32_t index);
+void            location_set_forecast(uint32_t index, uint32_t icon_code, const char* label, double temperature, uint32_t timestamp);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _LOCATION_H_
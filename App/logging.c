@@ -14,7 +14,15 @@
  */
 static void log_start(void);
 static void log_service_setup(void);
-static void post_log(bool is_err, char* format_string, va_list args);
+static void post_log(uint8_t level, char* format_string, va_list args);
+static bool log_is_repeat(uint8_t level, const uint8_t* data, size_t length);
+static void log_post_repeats(uint8_t level, uint32_t count);
+static void log_configure_level(void);
+#if ENABLE_BINARY_LOGGING == true
+static size_t log_encode_args(uint8_t* record, size_t length, const char* format_string, va_list args);
+static size_t log_put_varint(uint8_t* record, size_t length, uint64_t value);
+static size_t log_base64_encode(char* out, const uint8_t* in, size_t length);
+#endif
 
 
 /*
@@ -29,6 +37,29 @@ static uint32_t log_state = USER_HANDLE_LOGGING_OFF;
 extern UART_HandleTypeDef uart;
 static bool uart_available = false;
 
+// The runtime log level. Lowered by `log_configure()`
+volatile uint8_t log_runtime_level = LOG_LEVEL_DEBUG;
+volatile uint8_t log_capture_level = LOG_LEVEL_DEBUG;
+
+// Message prefixes, indexed by level
+static const char* level_prefixes[] = { "[-----] ", "[ERROR] ", "[WARN]  ", "[INFO]  ", "[DEBUG] " };
+
+// Storm control settings and state
+static uint16_t rate_burst = LOG_RATE_BURST;
+static uint16_t rate_per_minute = LOG_RATE_PER_MINUTE;
+static LogStats log_stats = { 0 };
+static struct {
+    uint32_t    hash;
+    uint32_t    tick;
+    uint32_t    count;
+    uint8_t     level;
+} last_message = { 0 };
+
+#if ENABLE_BINARY_LOGGING == true
+// Start of the binary log format string section. Defined by the linker
+extern const char __start_log_formats[];
+#endif
+
 
 /**
  * @brief  Open a logging channel.
@@ -65,61 +96,533 @@ static void log_service_setup(void) {
 
 
 /**
- * @brief Issue a debug message.
+ * @brief Issue a text log message.
  *
+ * Called via the `LOG_xxx()` macros, which filter by level.
+ *
+ * @param level         The message's level, eg. `LOG_LEVEL_ERROR`
  * @param format_string Message string with optional formatting
  * @param ...           Optional injectable values
  */
-void server_log(char* format_string, ...) {
+void log_text(uint8_t level, char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    post_log(level, format_string, args);
+    va_end(args);
+}
 
-    if (LOG_DEBUG_MESSAGES) {
-        va_list args;
-        va_start(args, format_string);
-        post_log(false, format_string, args);
-        va_end(args);
+
+/**
+ * @brief Post a message retained from the previous run.
+ *
+ * The message is already formatted, so it is posted as it is, after a
+ * marker. It is not retained again, or it would be reported once more,
+ * nested, after the next reset. Repeat checks are skipped.
+ *
+ * @param level   The level to post the message at, eg. `LOG_LEVEL_WARN`
+ * @param message The message, including its original level prefix
+ */
+void log_replay(uint8_t level, const char* message) {
+
+    if (level > log_runtime_level) return;
+
+    log_start();
+    char buffer[CRASHLOG_RECORD_LEN_B + 12] = {0};
+    snprintf(buffer, sizeof(buffer), "%s> %s", level_prefixes[level], message);
+
+    size_t length = strlen(buffer);
+    mvServerLog((const uint8_t*)buffer, (uint16_t)length);
+    if (uart_available) log_uart_output(buffer);
+}
+
+
+/**
+ * @brief Set the runtime log level.
+ *
+ * Levels above the compiled-in `LOG_LEVEL` cannot be enabled this way.
+ *
+ * @param level The most verbose level to log, eg. `LOG_LEVEL_INFO`
+ */
+void log_set_level(uint8_t level) {
+
+    if (level > LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+    log_runtime_level = level;
+
+    // Keep formatting messages the crash log retains
+    log_capture_level = level > CRASHLOG_LEVEL ? level : CRASHLOG_LEVEL;
+}
+
+
+/**
+ * @brief Apply the runtime log level held in the config store, if any.
+ */
+static void log_configure_level(void) {
+
+    char value[65] = { 0 };
+    if (!config_get_value(value, LOG_LEVEL_CONFIG_KEY)) return;
+
+    static const char* level_names[] = { "none", "error", "warn", "info", "debug" };
+    for (uint8_t i = 0 ; i <= LOG_LEVEL_DEBUG ; ++i) {
+        if (strcmp(value, level_names[i]) == 0) {
+            // Report the change at the outgoing level
+            LOG_INFO("Log level set to %s", level_names[i]);
+            log_set_level(i);
+            return;
+        }
     }
+
+    LOG_WARN("Unknown log level '%s'", value);
 }
 
 
 /**
- * @brief Issue an error message.
+ * @brief Set the per-call site rate limit.
  *
- * @param format_string Message string with optional formatting
- * @param ...           Optional injectable values
+ * @param burst      The number of messages a call site may issue at once.
+ * @param per_minute The steady rate thereafter. Zero disables rate limiting.
  */
-void server_error(char* format_string, ...) {
+void log_set_rate_limit(uint16_t burst, uint16_t per_minute) {
 
-    va_list args;
-    va_start(args, format_string);
-    post_log(true, format_string, args);
-    va_end(args);
+    rate_burst = burst > 0 ? burst : 1;
+    rate_per_minute = per_minute;
+}
+
+
+/**
+ * @brief Apply the runtime log settings held in the config store, if any.
+ *
+ * The value of the per-device config item `log-level` may be
+ * `none`, `error`, `warn`, `info` or `debug`. The value of
+ * `log-rate-limit` is `<burst>,<messages per minute>`.
+ */
+void log_configure(void) {
+
+    log_configure_level();
+
+    char value[65] = { 0 };
+    if (!config_get_value(value, LOG_RATE_CONFIG_KEY)) return;
+
+    unsigned burst = 0;
+    unsigned per_minute = 0;
+    if (sscanf(value, "%u,%u", &burst, &per_minute) == 2 && burst <= UINT16_MAX && per_minute <= UINT16_MAX) {
+        log_set_rate_limit((uint16_t)burst, (uint16_t)per_minute);
+        LOG_INFO("Log rate limit set to %u then %u per minute", burst, per_minute);
+    } else {
+        LOG_WARN("Unknown log rate limit '%s'", value);
+    }
+}
+
+
+/**
+ * @brief Apply a call site's rate limit.
+ *
+ * Called via the `LOG_xxx()` macros before the message's values are
+ * evaluated. Each site holds a token bucket that refills at the
+ * configured rate. If the site had messages dropped, a note of how
+ * many is logged before its next message.
+ *
+ * @param site  The call site's state.
+ * @param level The message's level, eg. `LOG_LEVEL_ERROR`
+ *
+ * @returns `true` if the message should be logged, otherwise `false`.
+ */
+bool log_site_allow(LogSite* site, uint8_t level) {
+
+    // Messages only kept for the crash log are never posted,
+    // so don't charge them to the site's bucket
+    if (rate_per_minute == 0 || level > log_runtime_level) return true;
+
+    uint32_t now = HAL_GetTick();
+    uint32_t interval = 60000 / rate_per_minute;
+    if (interval == 0) interval = 1;
+
+    // A site may log from more than one task, and the counters are shared
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (!site->started) {
+        site->started = true;
+        site->tokens = rate_burst;
+        site->last_refill = now;
+    }
+
+    // Add tokens for the time elapsed since the last refill
+    uint32_t earned = (now - site->last_refill) / interval;
+    if (earned > 0) {
+        site->last_refill += earned * interval;
+        site->tokens = (site->tokens + earned >= rate_burst) ? rate_burst : site->tokens + earned;
+    }
+
+    bool allow = site->tokens > 0;
+    uint16_t suppressed = 0;
+    if (allow) {
+        site->tokens--;
+        suppressed = site->suppressed;
+        site->suppressed = 0;
+    } else {
+        if (site->suppressed < UINT16_MAX) site->suppressed++;
+        log_stats.rate_limited++;
+    }
+
+    __set_PRIMASK(primask);
+
+    if (suppressed > 0) LOG_POST(level, "%u similar messages were rate limited", suppressed);
+    return allow;
+}
+
+
+/**
+ * @brief Report repeats of the last message once its repeat window
+ *        has closed, rather than waiting for a different message.
+ *
+ * Call periodically.
+ */
+void log_flush_repeats(void) {
+
+    uint32_t now = HAL_GetTick();
+    uint32_t count = 0;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (last_message.count > 0 && now - last_message.tick >= LOG_DEDUP_WINDOW_MS) {
+        count = last_message.count;
+        last_message.count = 0;
+    }
+
+    uint8_t level = last_message.level;
+    __set_PRIMASK(primask);
+
+    log_post_repeats(level, count);
+}
+
+
+/**
+ * @brief Get the logging counters.
+ *
+ * @param stats The counters are written here.
+ */
+void log_get_stats(LogStats* stats) {
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = log_stats;
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Check for a repeat of the previous message.
+ *
+ * Messages are compared by hash. A repeat within `LOG_DEDUP_WINDOW_MS`
+ * of the first instance is counted and should be dropped. Otherwise,
+ * any pending repeat count is logged before the new message.
+ *
+ * @param level  The message's level, eg. `LOG_LEVEL_ERROR`
+ * @param data   The formatted or encoded message.
+ * @param length The message length in bytes.
+ *
+ * @returns `true` if the message is a repeat, otherwise `false`.
+ */
+static bool log_is_repeat(uint8_t level, const uint8_t* data, size_t length) {
+
+    // FNV-1a
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0 ; i < length ; ++i) {
+        hash = (hash ^ data[i]) * 16777619UL;
+    }
+
+    // Messages are posted from more than one task, so the check
+    // and the update must be made together
+    uint32_t now = HAL_GetTick();
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    bool is_repeat = (hash == last_message.hash && now - last_message.tick < LOG_DEDUP_WINDOW_MS);
+    uint32_t repeats = 0;
+    uint8_t repeat_level = last_message.level;
+    if (is_repeat) {
+        last_message.count++;
+        log_stats.repeats++;
+    } else {
+        repeats = last_message.count;
+        last_message.hash = hash;
+        last_message.tick = now;
+        last_message.count = 0;
+        last_message.level = level;
+        log_stats.sent++;
+    }
+
+    __set_PRIMASK(primask);
+
+    // Not a repeat, so report any repeats of the previous message
+    if (!is_repeat) log_post_repeats(repeat_level, repeats);
+    return is_repeat;
+}
+
+
+/**
+ * @brief Log how many times a message was repeated, if it was.
+ *
+ * @param level The repeated message's level, eg. `LOG_LEVEL_ERROR`
+ * @param count The number of repeats, taken from `last_message`.
+ */
+static void log_post_repeats(uint8_t level, uint32_t count) {
+
+    if (count == 0) return;
+
+    char note[48] = { 0 };
+    sprintf(note, "%sLast message repeated %lu times", level_prefixes[level], count);
+    mvServerLog((const uint8_t*)note, (uint16_t)strlen(note));
+    if (uart_available) log_uart_output(note);
 }
 
 
 /**
  * @brief Issue any log message.
  *
- * @param is_err        Is the message an error?
+ * @param level         The message's level, eg. `LOG_LEVEL_ERROR`
  * @param format_string Message string with optional formatting
  * @param args          va_list of args from previous call
  */
-static void post_log(bool is_err, char* format_string, va_list args) {
+static void post_log(uint8_t level, char* format_string, va_list args) {
 
+    TRACE_SPAN_BEGIN(TRACE_SPAN_POST_LOG);
     log_start();
     static char buffer[LOG_MESSAGE_MAX_LEN_B] = {0};
 
     // Write the message type to the message
-    sprintf(buffer, is_err ? "[ERROR] " : "[DEBUG] ");
+    sprintf(buffer, "%s", level_prefixes[level]);
 
     // Write the formatted text to the message
     vsnprintf(&buffer[8], sizeof(buffer) - 9, format_string, args);
 
-    // Output the message using the system call
-    mvServerLog((const uint8_t*)buffer, (uint16_t)strlen(buffer));
+    // Keep a copy in case we crash. Messages more verbose than
+    // the runtime level go no further
+    crashlog_add(buffer);
 
-    // Do we output via UART too?
-    if (uart_available) log_uart_output(buffer);
+    // Drop repeats of the previous message
+    size_t length = strlen(buffer);
+    if (level <= log_runtime_level && !log_is_repeat(level, (const uint8_t*)buffer, length)) {
+        // Output the message using the system call
+        mvServerLog((const uint8_t*)buffer, (uint16_t)length);
+
+        // Do we output via UART too?
+        if (uart_available) log_uart_output(buffer);
+    }
+
+    TRACE_SPAN_END(TRACE_SPAN_POST_LOG);
+}
+
+
+#if ENABLE_BINARY_LOGGING == true
+/**
+ * @brief Issue a log message as a compact binary record.
+ *
+ * The record is the format string's ID, shifted left three bits with
+ * the level in bits 0-2, then each argument. No text formatting is
+ * performed unless UART logging is active. Called via the `LOG_xxx()`
+ * macros when `ENABLE_BINARY_LOGGING` is `true`.
+ *
+ * @param level         The message's level, eg. `LOG_LEVEL_ERROR`
+ * @param format_string Message string in the `log_formats` section
+ * @param ...           Optional injectable values
+ */
+void log_binary(uint8_t level, const char* format_string, ...) {
+
+    TRACE_SPAN_BEGIN(TRACE_SPAN_POST_LOG);
+    log_start();
+    static uint8_t record[LOG_BINARY_RECORD_MAX_LEN_B] = {0};
+    static char buffer[sizeof(LOG_BINARY_MARKER) + (LOG_BINARY_RECORD_MAX_LEN_B + 2) / 3 * 4] = LOG_BINARY_MARKER;
+
+    va_list args;
+    va_list uart_args;
+    va_start(args, format_string);
+    va_copy(uart_args, args);
+
+    // Write the ID and level, then the values
+    uint32_t id = (uint32_t)(format_string - __start_log_formats);
+    size_t length = log_put_varint(record, 0, ((uint64_t)id << 3) | (level & 0x07));
+    length = log_encode_args(record, length, format_string, args);
+    va_end(args);
+
+    size_t text_length = sizeof(LOG_BINARY_MARKER) - 1;
+    text_length += log_base64_encode(&buffer[text_length], record, length);
+
+    // Keep a copy in case we crash. Messages more verbose than
+    // the runtime level go no further
+    crashlog_add(buffer);
+
+    // Drop repeats of the previous message
+    if (level <= log_runtime_level && !log_is_repeat(level, record, length)) {
+        // Output the message using the system call
+        mvServerLog((const uint8_t*)buffer, (uint16_t)text_length);
+
+        // Do we output via UART too? If so, it gets the text version
+        if (uart_available) {
+            static char uart_text[LOG_MESSAGE_MAX_LEN_B] = {0};
+            sprintf(uart_text, "%s", level_prefixes[level]);
+            vsnprintf(&uart_text[8], sizeof(uart_text) - 9, format_string, uart_args);
+            log_uart_output(uart_text);
+        }
+    }
+
+    va_end(uart_args);
+    TRACE_SPAN_END(TRACE_SPAN_POST_LOG);
+}
+
+
+/**
+ * @brief Append a binary log message's values to its record.
+ *
+ * The format string is scanned only to find each value's type. Integers
+ * are written as varints (signed values zig-zag encoded first), floating
+ * point values as little-endian doubles, and strings as a varint length
+ * followed by the characters. Strings are truncated to fit the record.
+ *
+ * @param record        The record buffer.
+ * @param length        The number of bytes already in the record.
+ * @param format_string Message string with optional formatting
+ * @param args          va_list of args from previous call
+ *
+ * @returns The new record length.
+ */
+static size_t log_encode_args(uint8_t* record, size_t length, const char* format_string, va_list args) {
+
+    const char* f = format_string;
+    while (*f != 0) {
+        if (*f++ != '%') continue;
+        if (*f == '%') {
+            f++;
+            continue;
+        }
+
+        // Skip flags, width and precision. `*` takes an int value
+        while (strchr("-+ #0", *f) != NULL && *f != 0) f++;
+        while ((*f >= '0' && *f <= '9') || *f == '.' || *f == '*') {
+            if (*f == '*') length = log_put_varint(record, length, (uint32_t)va_arg(args, int));
+            f++;
+        }
+
+        // Length modifiers: only `ll` and `j` widen values on this target
+        bool is_64 = false;
+        while (strchr("hlLqjzt", *f) != NULL && *f != 0) {
+            if (*f == 'j' || (*f == 'l' && f[1] == 'l')) is_64 = true;
+            f++;
+        }
+
+        // Write the value itself
+        switch (*f) {
+            case 'd':
+            case 'i': {
+                int64_t value = is_64 ? va_arg(args, int64_t) : va_arg(args, int);
+                length = log_put_varint(record, length, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'c':
+                length = log_put_varint(record, length, is_64 ? va_arg(args, uint64_t) : va_arg(args, unsigned int));
+                break;
+            case 'p':
+                length = log_put_varint(record, length, (uintptr_t)va_arg(args, void*));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double value = va_arg(args, double);
+                if (length + sizeof(value) <= LOG_BINARY_RECORD_MAX_LEN_B) {
+                    memcpy(&record[length], &value, sizeof(value));
+                    length += sizeof(value);
+                }
+                break;
+            }
+            case 's': {
+                const char* value = va_arg(args, const char*);
+                if (value == NULL) value = "(null)";
+                size_t value_length = strlen(value);
+                size_t space = LOG_BINARY_RECORD_MAX_LEN_B - length;
+                if (space == 0) break;
+
+                // Keep the length to a single varint byte
+                if (value_length > 127) value_length = 127;
+                if (value_length > space - 1) value_length = space - 1;
+                length = log_put_varint(record, length, value_length);
+                memcpy(&record[length], value, value_length);
+                length += value_length;
+                break;
+            }
+            default:
+                // Unsupported conversion: stop rather than misread the va_list
+                return length;
+        }
+
+        if (*f != 0) f++;
+    }
+
+    return length;
+}
+
+
+/**
+ * @brief Write a value to a record as an LEB128 varint.
+ *
+ * @param record The record buffer.
+ * @param length The number of bytes already in the record.
+ * @param value  The value to write.
+ *
+ * @returns The new record length. Unchanged if the value would not fit.
+ */
+static size_t log_put_varint(uint8_t* record, size_t length, uint64_t value) {
+
+    uint8_t bytes[10];
+    size_t count = 0;
+    do {
+        bytes[count] = (value & 0x7F) | (value > 0x7F ? 0x80 : 0x00);
+        value >>= 7;
+        count++;
+    } while (value != 0);
+
+    if (length + count > LOG_BINARY_RECORD_MAX_LEN_B) return length;
+    memcpy(&record[length], bytes, count);
+    return length + count;
+}
+
+
+/**
+ * @brief Base64 encode a binary record.
+ *
+ * @param out    The destination. Must hold (length + 2) / 3 * 4 + 1 characters.
+ * @param in     The binary data.
+ * @param length The number of bytes to encode.
+ *
+ * @returns The number of characters written, excluding the terminating NUL.
+ */
+static size_t log_base64_encode(char* out, const uint8_t* in, size_t length) {
+
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t count = 0;
+    for (size_t i = 0 ; i < length ; i += 3) {
+        uint32_t group = (uint32_t)in[i] << 16;
+        if (i + 1 < length) group |= (uint32_t)in[i + 1] << 8;
+        if (i + 2 < length) group |= in[i + 2];
+
+        out[count++] = alphabet[(group >> 18) & 0x3F];
+        out[count++] = alphabet[(group >> 12) & 0x3F];
+        out[count++] = i + 1 < length ? alphabet[(group >> 6) & 0x3F] : '=';
+        out[count++] = i + 2 < length ? alphabet[group & 0x3F] : '=';
+    }
+
+    out[count] = 0;
+    return count;
 }
+#endif
 
 
 /**
@@ -131,7 +634,9 @@ static void post_log(bool is_err, char* format_string, va_list args) {
 void do_assert(bool condition, char* message) {
 
     if (!condition) {
-        server_error(message);
+        // Record the fault first: logging may be what failed
+        crashlog_fault(CRASHLOG_FAULT_ASSERT, 0, message);
+        LOG_ERROR("%s", message);
         assert(false);
     }
 }
@@ -23,6 +23,56 @@
 #define     LOG_MESSAGE_MAX_LEN_B               1024
 #define     LOG_BUFFER_SIZE_B                   4096
 
+// Log levels. Each message prefix is eight characters
+#define     LOG_LEVEL_NONE                      0
+#define     LOG_LEVEL_ERROR                     1
+#define     LOG_LEVEL_WARN                      2
+#define     LOG_LEVEL_INFO                      3
+#define     LOG_LEVEL_DEBUG                     4
+
+// The most verbose level compiled in. Set in the root `CMakeLists.txt`
+#ifndef     LOG_LEVEL
+#define     LOG_LEVEL                           LOG_LEVEL_DEBUG
+#endif
+
+// A source file's most verbose level. Set per file in `App/CMakeLists.txt`
+#ifndef     LOG_MODULE_LEVEL
+#define     LOG_MODULE_LEVEL                    LOG_LEVEL
+#endif
+
+// Per-device config store key holding the runtime log level
+#define     LOG_LEVEL_CONFIG_KEY                "log-level"
+
+// Storm control. Each call site may log a burst of messages, then
+// is limited to a steady rate. Identical consecutive messages within
+// the window are collapsed into a single "repeated N times" line
+#define     LOG_RATE_BURST                      5
+#define     LOG_RATE_PER_MINUTE                 6
+#define     LOG_DEDUP_WINDOW_MS                 60000
+#define     LOG_RATE_CONFIG_KEY                 "log-rate-limit"
+
+
+/*
+ * STRUCTURES
+ */
+typedef struct {
+    uint32_t    last_refill;
+    uint16_t    tokens;
+    uint16_t    suppressed;
+    bool        started;
+} LogSite;
+
+typedef struct {
+    uint32_t    sent;
+    uint32_t    rate_limited;
+    uint32_t    repeats;
+} LogStats;
+
+// Binary logging: records are base64 encoded so they survive the
+// text log pipeline, and marked so `tools/log_decode.py` can find them
+#define     LOG_BINARY_RECORD_MAX_LEN_B         256
+#define     LOG_BINARY_MARKER                   "#L:"
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,14 +82,58 @@ extern "C" {
 /*
  * PROTOTYPES
  */
-void server_log(char* format_string, ...)        __attribute__ ((__format__ (__printf__, 1, 2)));
-void server_error(char* format_string, ...)      __attribute__ ((__format__ (__printf__, 1, 2)));
+void log_text(uint8_t level, char* format_string, ...)                  __attribute__ ((__format__ (__printf__, 2, 3)));
+void log_binary(uint8_t level, const char* format_string, ...)          __attribute__ ((__format__ (__printf__, 2, 3)));
+void log_replay(uint8_t level, const char* message);
+void log_set_level(uint8_t level);
+void log_set_rate_limit(uint16_t burst, uint16_t per_minute);
+void log_configure(void);
+bool log_site_allow(LogSite* site, uint8_t level);
+void log_get_stats(LogStats* stats);
+void log_flush_repeats(void);
 void do_assert(bool condition, char* message);
 
+// The runtime log level. Messages more verbose than this are not posted
+extern volatile uint8_t log_runtime_level;
+// The greater of the runtime and retained log levels. Messages more
+// verbose than this are skipped
+extern volatile uint8_t log_capture_level;
+
 
 #ifdef __cplusplus
 }
 #endif
 
 
+/*
+ * MACROS
+ */
+#if ENABLE_BINARY_LOGGING == true
+// Place each format string in the `log_formats` section. A string's
+// offset in that section is its ID. The section is extracted from the
+// .elf at build time to form the decoder's dictionary
+#define     LOG_FORMAT(format)                  ({ static const char log_fmt[] __attribute__((section("log_formats"))) = format; log_fmt; })
+#define     LOG_POST(level, format, ...)        log_binary(level, LOG_FORMAT(format), ##__VA_ARGS__)
+#else
+#define     LOG_POST(level, format, ...)        log_text(level, format, ##__VA_ARGS__)
+#endif
+
+// Levels above the module's compiled-in level are constant-false,
+// so the call and its arguments are removed entirely. Otherwise the
+// runtime level and the call site's rate limit are checked before
+// any arguments are evaluated
+#define     LOG_AT(level, ...)                  do { if ((level) <= LOG_MODULE_LEVEL && (level) <= log_capture_level) { \
+                                                    static LogSite log_site = { 0 }; \
+                                                    if (log_site_allow(&log_site, level)) LOG_POST(level, __VA_ARGS__); \
+                                                } } while (0)
+#define     LOG_ERROR(...)                      LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define     LOG_WARN(...)                       LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define     LOG_INFO(...)                       LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define     LOG_DEBUG(...)                      LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+// Original logging calls
+#define     server_log(...)                     LOG_DEBUG(__VA_ARGS__)
+#define     server_error(...)                   LOG_ERROR(__VA_ARGS__)
+
+
 #endif /* LOGGING_H */
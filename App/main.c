@@ -17,8 +17,14 @@ static void system_clock_config(void);
 static void GPIO_init(void);
 static void task_led(void *unused_arg);
 static void task_iot(void *unused_arg);
-static void process_http_response(void);
+static bool fetch_http_response(uint32_t index, uint32_t request_ms);
+static void apply_forecast_result(const Forecast* result);
+static bool process_telemetry_response(void);
 static void log_device_info(void);
+static void display_init(uint32_t icon_code);
+#if ENABLE_FORECAST_CACHE == true
+static void load_cached_forecast(void);
+#endif
 static void do_polite_deploy(void* arg);
 
 
@@ -43,18 +49,12 @@ static const osThreadAttr_t iot_task_attributes = {
     .priority = (osPriority_t)osPriorityNormal
 };
 
-// I2C-related values
-I2C_HandleTypeDef i2c;
-char forecast[48] = "None";
-
 /**
  *  Theses variables may be changed by interrupt handler code,
  *  so we mark them as `volatile` to ensure compiler optimization
  *  doesn't render them immutable at runtime
  */
 volatile bool           use_i2c = false;
-volatile uint8_t        icon_code = 12;
-volatile bool           new_forecast = false;
 volatile bool           received_request = false;
 volatile bool           channel_was_closed = false;
 volatile bool           polite_deploy = false;
@@ -78,56 +78,60 @@ extern struct {
  */
 int main(void) {
 
+    // Pick up the previous run's retained log, if any, and start this run's
+    crashlog_init();
+
     // Reset of all peripherals, Initializes the Flash interface and the Systick.
     HAL_Init();
+    boot_mark(BOOT_MILESTONE_HAL_INIT);
 
     // Configure the system clock
     system_clock_config();
 
+#if ENABLE_TRACE == true
+    // Start recording trace events
+    trace_init();
+#endif
+
     // Get the Device ID and build number
     log_device_info();
+    boot_mark(BOOT_MILESTONE_DEVICE_INFO);
 
-    // Start the network
-    net_open_network();
-    shared_setup_notification_center();
+    // Set this device's polling phase
+    poll_init();
 
     // Initialize the peripherals
     GPIO_init();
-    I2C_init();
 
-    // Set up the display if it's available
-    if (use_i2c) {
-        HT16K33_init(2);
-
-        // Set the weather icons
-        HT16K33_define_character("\x91\x42\x18\x3d\xbc\x18\x42\x89", CLEAR_DAY);
-        HT16K33_define_character("\x31\x7A\x78\xFA\xFC\xF9\x7A\x30", RAIN);
-        HT16K33_define_character("\x31\x7A\x78\xFA\xFC\xF9\x7A\x30", DRIZZLE);
-        HT16K33_define_character("\x28\x92\x54\x38\x38\x54\x92\x28", SNOW);
-        HT16K33_define_character("\x32\x7D\x7A\xFD\xFA\xFD\x7A\x35", SLEET);
-        HT16K33_define_character("\x28\x28\x28\x28\x28\xAA\xAA\x44", WIND);
-        HT16K33_define_character("\xAA\x55\xAA\x55\xAA\x55\xAA\x55", FOG);
-        HT16K33_define_character("\x30\x78\x78\xF8\xF8\xF8\x78\x30", CLOUDY);
-        HT16K33_define_character("\x30\x48\x48\x88\x88\x88\x48\x30", PARTLY_CLOUDY);
-        HT16K33_define_character("\x00\x00\x00\x0F\x38\xE0\x00\x00", THUNDERSTORM);
-        HT16K33_define_character("\x00\x40\x6C\xBE\xBB\xB1\x60\x40", TORNADO);
-        HT16K33_define_character("\x3C\x42\x81\xC3\xFF\xFF\x7E\x3C", CLEAR_NIGHT);
-        HT16K33_define_character("\x00\x00\x40\x9D\x90\x60\x00\x00", NONE);
-
-        char* title = malloc(42);
-        sprintf(title, "    %s %s    ", APP_NAME, APP_VERSION);
-        HT16K33_print(title, 75);
-        free(title);
-    }
+    // Set up the notification center for HTTP, config and system
+    // notifications. This does not need the network to be up
+    shared_setup_notification_center();
+    boot_mark(BOOT_MILESTONE_NC_SETUP);
 
     // Init scheduler
     osKernelInitialize();
 
-    // Create the thread(s)
+    // Start periodic task stack and CPU usage reporting
+    diag_init();
+
+    // Start sampling telemetry for batched upload
+    telemetry_init();
+
+    // Set up the fetch, parse and render stages' queues, and the parse task
+    forecast_pipeline_init();
+
+#if ENABLE_FORECAST_CACHE == true
+    // Show the last forecast until we get a new one, if it's recent enough
+    load_cached_forecast();
+#endif
+
+    // Create the thread(s). The network is brought up by `task_iot()`
+    // and the display by `task_led()`, so neither waits for the other
     thread_iot = osThreadNew(task_iot, NULL, &iot_task_attributes);
     thread_led = osThreadNew(task_led, NULL, &led_task_attributes);
 
     // Start the scheduler
+    boot_mark(BOOT_MILESTONE_KERNEL_START);
     osKernelStart();
 
     // We should never get here as control is now taken by the scheduler,
@@ -192,11 +196,60 @@ static void GPIO_init(void) {
 static void task_led(void *unused_arg) {
 
     uint32_t last_tick = 0;
+    uint32_t last_rotate_tick = 0;
     osTimerId_t polite_timer;
     bool connection_pixel_state = false;
 
+    // The render stage's state, which only this task sees: the
+    // location on the display, its forecast text and icon
+    uint32_t shown_location = 0;
+    char forecast_text[FORECAST_TEXT_LEN_B] = "None";
+    uint32_t icon_code = NONE;
+    bool new_forecast = false;
+
+    // The published forecasts, and the version of each last shown
+    static ForecastSnapshot snapshot;
+    uint32_t snapshot_sequence = 0;
+    uint32_t seen_versions[LOCATION_MAX] = { 0 };
+
+    // Locations whose forecasts have been taken but not yet drawn
+    uint32_t undrawn = 0;
+
+    // A cached forecast may already be published: show its icon straight away
+    bool updated = forecast_read(&snapshot, &snapshot_sequence);
+    display_init(snapshot.forecasts[0].valid ? snapshot.forecasts[0].icon_code : NONE);
+
     // The task's main loop
     while (1) {
+        // Pick up newly published forecasts. The copy is only made
+        // when something has changed, and never waits on the writer
+        if (updated || forecast_read(&snapshot, &snapshot_sequence)) {
+            updated = false;
+            for (uint32_t i = 0 ; i < LOCATION_MAX ; ++i) {
+                if (snapshot.versions[i] == seen_versions[i]) continue;
+                seen_versions[i] = snapshot.versions[i];
+
+                const Forecast* update = &snapshot.forecasts[i];
+                const Location* location = NULL;
+                if (update->location != FORECAST_LOCATION_CACHED) {
+                    location_set_forecast(i, update->icon_code, update->label, update->temperature / 10.0, update->timestamp);
+                    location = location_get(i);
+                    undrawn |= (1UL << i);
+                }
+
+                if (i == shown_location) {
+                    forecast_render(forecast_text, sizeof(forecast_text), (location != NULL ? location->name : ""), update->label, update->temperature);
+                    icon_code = update->icon_code;
+                    new_forecast = true;
+
+                    if (location != NULL) {
+                        TRACE_MARK(TRACE_MARK_NEW_FORECAST);
+                        boot_mark(BOOT_MILESTONE_FIRST_FORECAST);
+                    }
+                }
+            }
+        }
+
         // Check connection state
         is_connected = false;
         if (http_handles.network != 0) {
@@ -218,9 +271,22 @@ static void task_led(void *unused_arg) {
             }
 
             if (use_i2c) {
+                // Move on to the next location's forecast, if there are several
+                if (!new_forecast && location_count() > 1 && tick - last_rotate_tick > LOCATION_ROTATE_PERIOD_MS) {
+                    last_rotate_tick = tick;
+                    uint32_t next = location_next(shown_location);
+                    if (next != shown_location) {
+                        const Location* location = location_get(next);
+                        shown_location = next;
+                        forecast_render(forecast_text, sizeof(forecast_text), location->name, location->label, location->temperature);
+                        icon_code = location->icon_code;
+                        new_forecast = true;
+                    }
+                }
+
                 if (new_forecast) {
                     // Display the new forecast as a string
-                    HT16K33_print(forecast, 100);
+                    HT16K33_print(forecast_text, 100);
 
                     // Wait before showing the icon
                     sleep_ms(1500);
@@ -239,6 +305,13 @@ static void task_led(void *unused_arg) {
                 HT16K33_draw_def_char(icon_code);
                 HT16K33_plot(7, 7, connection_pixel_state);
                 HT16K33_draw();
+
+                // Time every forecast taken since the last refresh,
+                // whichever location is on the display
+                for (uint32_t i = 0 ; undrawn != 0 ; ++i) {
+                    if (undrawn & (1UL << i)) latency_mark(i, LATENCY_STAGE_FIRST_DRAW);
+                    undrawn &= ~(1UL << i);
+                }
             }
         }
 
@@ -246,7 +319,7 @@ static void task_led(void *unused_arg) {
         // Check if the polite deployment flag has been set
         // via a Microvisor system notification
         if (polite_deploy) {
-            server_log("Polite deployment notification issued");
+            LOG_INFO("Polite deployment notification issued");
             polite_deploy = false;
             flash_led = true;
 
@@ -257,7 +330,7 @@ static void task_led(void *unused_arg) {
             polite_timer = osTimerNew(do_polite_deploy, osTimerOnce, NULL, NULL);
             const uint32_t timer_delay_s = 30;
             if (polite_timer != NULL && osTimerStart(polite_timer, timer_delay_s * 1000) == osOK) {
-                server_log("Update will install in %lu seconds", timer_delay_s);
+                LOG_INFO("Update will install in %lu seconds", timer_delay_s);
             }
         }
 
@@ -274,34 +347,117 @@ static void task_led(void *unused_arg) {
  */
 static void task_iot(void *unused_arg) {
 
+    // Start the network and wait for it to connect
+    net_open_network();
+    boot_mark(BOOT_MILESTONE_NETWORK_UP);
+
+    // Report how the previous run ended, now that we can
+    crashlog_report();
+
+#if ENABLE_JSON_BENCHMARK == true
+    // Measure JSON parsing throughput, and time each forecast pipeline stage
+    json_benchmark();
+    forecast_benchmark();
+#endif
+
+    // Fetch the per-device settings from the config store in one request
+    config_preload();
+
+    // Apply the runtime log level from the config store
+    log_configure();
+
+    // Load the forecast locations from the config store
+    // NOTE The default is derived from env vars -- see README.md
+    location_configure(LATITUDE, LONGITUDE);
+
     // Configure OpenWeather
-    // NOTE These values derived from env vars -- see README.md
-    OW_init(LATITUDE, LONGITUDE);
+    OW_init();
+
+    // Apply the polling schedule from the config store
+    poll_configure();
+
+    // Apply the telemetry endpoint and upload period from the config store
+    telemetry_configure();
 
     // Time trackers
-    uint32_t read_tick = HAL_GetTick() - WEATHER_READ_PERIOD_MS;
     uint32_t kill_time = 0;
     bool do_close_channel = false;
 
+    // The location being fetched. A poll requests every location's
+    // forecast in turn over the same channel
+    uint32_t fetch_index = 0;
+    uint32_t fetch_start_tick = 0;
+
+    // The first location's forecast decides the poll's outcome. The
+    // channel is closed without waiting for it to be parsed, but the
+    // poll only finishes once the outcome comes back from the pipeline
+    bool result_pending = false;
+    bool channel_closed = false;
+
+    // Telemetry is uploaded on its own channel, between polls
+    bool uploading = false;
+    bool upload_accepted = false;
+
     // Run the thread's main loop
     while (1) {
         uint32_t tick = HAL_GetTick();
-        if (tick - read_tick > WEATHER_READ_PERIOD_MS) {
-            read_tick = tick;
+        if (poll_due(tick) && !net_is_connected()) {
+            // Don't open a channel just to wait for it to time out
+            poll_offline(tick);
+        } else if (poll_due(tick) && !uploading) {
+            poll_started(location_count());
 
             // No channel open? Try and send the temperature
             if (http_handles.channel == 0) {
                 http_open_channel();
-                bool result = OW_request_forecast();
+                fetch_index = 0;
+                fetch_start_tick = tick;
+                result_pending = false;
+                channel_closed = false;
+                latency_mark(fetch_index, LATENCY_STAGE_REQUEST);
+                const Location* location = location_get(fetch_index);
+                bool result = OW_request_forecast(location->latitude, location->longitude);
                 if (!result) do_close_channel = true;
                 kill_time = tick;
             } else {
-                server_error("Channel handle not zero");
+                LOG_WARN("Channel handle not zero");
+                poll_finished(tick);
             }
+        } else if (http_handles.channel == 0 && telemetry_due(tick) && net_is_connected()) {
+            http_open_channel();
+            uploading = true;
+            upload_accepted = false;
+            if (!telemetry_send()) do_close_channel = true;
+            kill_time = tick;
         }
 
         // Process a request's response if indicated by the ISR
-        if (received_request) process_http_response();
+        if (received_request && uploading) {
+            received_request = false;
+            upload_accepted = process_telemetry_response();
+            do_close_channel = true;
+        } else if (received_request) {
+            received_request = false;
+            bool submitted = fetch_http_response(fetch_index, HAL_GetTick() - kill_time);
+            if (submitted && fetch_index == 0) result_pending = true;
+
+            // Request the next location's forecast on the same channel,
+            // or close it once every location has been fetched
+            fetch_index++;
+            if (fetch_index < location_count() && !channel_was_closed) {
+                const Location* location = location_get(fetch_index);
+                latency_mark(fetch_index, LATENCY_STAGE_REQUEST);
+                if (OW_request_forecast(location->latitude, location->longitude)) {
+                    kill_time = HAL_GetTick();
+                } else {
+                    do_close_channel = true;
+                }
+            } else {
+                do_close_channel = true;
+                uint32_t elapsed = HAL_GetTick() - fetch_start_tick;
+                LOG_DEBUG("Fetched %lu locations in %lu ms (%lu ms each)", fetch_index, elapsed, elapsed / fetch_index);
+            }
+        }
 
 
         // FROM 2.0.7
@@ -310,21 +466,49 @@ static void task_iot(void *unused_arg) {
         if (channel_was_closed) do_close_channel = true;
 
         // Use 'kill_time' to force-close an open HTTP channel
-        // if it's been left open too long
-        if (kill_time > 0 && tick - kill_time > CHANNEL_KILL_PERIOD_MS) {
+        // if it's been left open too long. `tick` may predate
+        // `kill_time`, which is reset when a request is issued
+        if (kill_time > 0 && HAL_GetTick() - kill_time > CHANNEL_KILL_PERIOD_MS) {
             do_close_channel = true;
-            server_error("HTTP request timed out");
+            LOG_WARN("HTTP request timed out");
         }
 
         // Close the channel if asked to do so or
-        // a request yielded a response
-        if (do_close_channel || received_request) {
+        // the last request yielded a response
+        if (do_close_channel) {
             do_close_channel = false;
-            received_request = false;
             kill_time = 0;
             http_close_channel();
+
+            // Schedule the next upload or poll
+            if (uploading) {
+                uploading = false;
+                telemetry_finished(upload_accepted, HAL_GetTick());
+            } else if (result_pending) {
+                channel_closed = true;
+            } else {
+                poll_finished(HAL_GetTick());
+            }
+        }
+
+        // Apply the first location's forecast to the polling
+        // schedule, once the pipeline has parsed it
+        Forecast result;
+        if (forecast_take_result(&result)) {
+            apply_forecast_result(&result);
+            result_pending = false;
+            if (channel_closed) {
+                channel_closed = false;
+                poll_finished(HAL_GetTick());
+            }
         }
 
+        // Report repeated log messages without waiting for a different one
+        log_flush_repeats();
+
+        // Report the boot times if the first forecast is late
+        boot_check_report(HAL_GetTick());
+
         // End of cycle delay
         osDelay(10);
     }
@@ -332,9 +516,17 @@ static void task_iot(void *unused_arg) {
 
 
 /**
- * @brief Process HTTP response data.
+ * @brief Fetch stage: read a forecast response and pass its body
+ *        on to be parsed.
+ *
+ * Only the first location's outcome drives the polling schedule.
+ *
+ * @param index:      The location the response is for.
+ * @param request_ms: The time between sending the request and its response.
+ *
+ * @returns `true` if the body was passed on, otherwise `false`.
  */
-static void process_http_response(void) {
+static bool fetch_http_response(uint32_t index, uint32_t request_ms) {
 
     // We have received data via the active HTTP channel so establish
     // an `MvHttpResponseData` record to hold response metadata
@@ -347,136 +539,87 @@ static void process_http_response(void) {
             if (resp_data.status_code == 200) {
                 server_log("HTTP response body length: %lu", resp_data.body_length);
 
-                // Set up a buffer that we'll get Microvisor
+                // Get a buffer that we'll get Microvisor
                 // to write the response body into
-                static uint8_t body_buffer[1500];
-                memset((void *)body_buffer, 0x00, 1500);
-                status = mvReadHttpResponseBody(http_handles.channel, 0, body_buffer, 1500);
-                if (status == MV_STATUS_OKAY) {
-                    uint32_t wid = 0;
-                    uint32_t code = NONE;
-                    double temp = 0.0;
-                    char cast[14] = "None";
-
-                    // Parse the incoming JSON using cJSON
-                    // (https://github.com/DaveGamble/cJSON)
-                    cJSON *json = cJSON_Parse((char *)body_buffer);
-                    if (json == NULL) {
-                        // Parsing failed -- log an error and bail
-                        const char *error_ptr = cJSON_GetErrorPtr();
-                        if (error_ptr != NULL) {
-                            server_error("Cant parse JSON, before %s", error_ptr);
-                        }
-                        cJSON_Delete(json);
-                        return;
-                    }
-
-                    // Extract current weather conditions from parsed JSON
-                    const cJSON *current = cJSON_GetObjectItemCaseSensitive(json, "current");
-                    const cJSON *weather = cJSON_GetObjectItemCaseSensitive(current, "weather");
-                    const cJSON *feels_like;
-
-                    if (weather != NULL) {
-                        cJSON *item = NULL;
-                        cJSON_ArrayForEach(item, weather) {
-                            // Get the info we're interested in
-                            const cJSON *icon = cJSON_GetObjectItemCaseSensitive(item, "icon");
-                            const cJSON *id = cJSON_GetObjectItemCaseSensitive(item, "id");
-                            const cJSON *main= cJSON_GetObjectItemCaseSensitive(item, "main");
-                            feels_like = cJSON_GetObjectItemCaseSensitive(current, "feels_like");
-
-                            // Set working values
-                            if (cJSON_IsNumber(id)) wid = (int)id->valuedouble;
-                            if (cJSON_IsString(main) && (main->valuestring != NULL)) {
-                                strcpy(cast, main->valuestring);
-                            }
-
-                            // Set standard icon values by weather condition
-                            if (strcmp(cast, "Rain") == 0) {
-                                code = RAIN;
-                            } else if (strcmp(cast, "Snow") == 0) {
-                                code = SNOW;
-                            } else if (strcmp(cast, "Thun") == 0) {
-                                code = THUNDERSTORM;
-                            }
-
-                            // Update icons and/or condition text for certain
-                            // quirky ID values
-                            if (wid == 771) {
-                                strcpy(cast, "Windy");
-                                code = WIND;
-                            }
-
-                            if (wid == 871) {
-                                strcpy(cast, "Tornado");
-                                code = TORNADO;
-                            }
-
-                            if (wid > 699 && wid < 770) {
-                                strcpy(cast, "Foggy");
-                                code = FOG;
-                            }
-
-                            if (strcmp(cast, "Clouds") == 0) {
-                                if (wid < 804) {
-                                    strcpy(cast, "Partly Cloudy");
-                                    code = PARTLY_CLOUDY;
-                                } else {
-                                    strcpy(cast, "Cloudy");
-                                    code = CLOUDY;
-                                }
-                            }
-
-                            if (wid > 602 && wid < 620) {
-                                strcpy(cast, "Sleet");
-                                code = SLEET;
-                            }
-
-                            if (strcmp(cast, "Drizzle") == 0) {
-                                code = DRIZZLE;
-                            }
-
-                            if (strcmp(cast, "Clear") == 0) {
-                                if (cJSON_IsString(icon) && (icon->valuestring != NULL)) {
-                                    if (icon->valuestring[2] == 'd') {
-                                        code = CLEAR_DAY;
-                                    } else {
-                                        code = CLEAR_NIGHT;
-                                    }
-                                }
-                            }
-                        }
-                    }
-
-                    // Did we get updated weather info?
-                    if (wid > 0) {
-                        // Yes! So update the forecast string, and tell the main loop
-                        // to refresh the display
-                        if (cJSON_IsNumber(feels_like)) {
-                            temp = feels_like->valuedouble;
-                        }
-
-                        sprintf(forecast, "    %s Out: %.1f", cast, temp);
-                        sprintf(&forecast[strlen(forecast)], "\x7F\x63\x20\x20\x20\x20");
-                        icon_code = code;
-                        new_forecast = true;
-                    }
+                uint32_t slot = 0;
+                char* body_buffer = forecast_claim_buffer(&slot);
+                if (body_buffer == NULL) {
+                    LOG_WARN("Forecast %lu dropped: parser busy", index + 1);
+                    return false;
+                }
 
-                    // Free the JSON parser
-                    cJSON_Delete(json);
-                    server_log("Forecast: %s (code: %lu) Feels Like %.1f°C", cast, code, temp);
-                } else {
-                    server_error("HTTP response body read status %i", status);
+                status = mvReadHttpResponseBody(http_handles.channel, 0, (uint8_t *)body_buffer, FORECAST_BODY_SIZE_B);
+                if (status == MV_STATUS_OKAY) {
+                    latency_mark(index, LATENCY_STAGE_BODY_READ);
+                    return forecast_submit(slot, index, resp_data.body_length, request_ms);
                 }
+
+                server_error("HTTP response body read status %i", status);
+                forecast_release_buffer(slot);
             } else {
                 server_error("HTTP status code: %lu", resp_data.status_code);
+                uint32_t failure = poll_classify(resp_data.result, resp_data.status_code);
+                if (index == 0) poll_failed(failure);
+
+                // The API key may have been changed: get it again before the next poll
+                if (failure == POLL_FAILURE_AUTH) OW_forget_key();
             }
         } else {
             server_error("Request failed. Status: %i", resp_data.result);
+            if (index == 0) poll_failed(poll_classify(resp_data.result, resp_data.status_code));
         }
     } else {
         server_error("Response data read failed. Status: %i", status);
     }
+
+    return false;
+}
+
+
+/**
+ * @brief Adapt polling to the first location's new forecast.
+ *
+ * @param result: The forecast, which may not be valid.
+ */
+static void apply_forecast_result(const Forecast* result) {
+
+    if (!result->valid) return;
+
+    double temp = result->temperature / 10.0;
+    poll_succeeded(result->timestamp, result->icon_code, temp);
+
+#if ENABLE_FORECAST_CACHE == true
+    // Keep the forecast for the next boot
+    forecast_cache_save(result->icon_code, result->label, temp, result->timestamp);
+#endif
+}
+
+
+/**
+ * @brief Check the response to a telemetry upload.
+ *
+ * @returns `true` if the endpoint accepted the batch, otherwise `false`.
+ */
+static bool process_telemetry_response(void) {
+
+    struct MvHttpResponseData resp_data;
+    enum MvStatus status = mvReadHttpResponseData(http_handles.channel, &resp_data);
+    if (status != MV_STATUS_OKAY) {
+        server_error("Response data read failed. Status: %i", status);
+        return false;
+    }
+
+    if (resp_data.result != MV_HTTPRESULT_OK) {
+        server_error("Request failed. Status: %i", resp_data.result);
+        return false;
+    }
+
+    if (resp_data.status_code < 200 || resp_data.status_code > 299) {
+        server_error("HTTP status code: %lu", resp_data.status_code);
+        return false;
+    }
+
+    return true;
 }
 
 
@@ -487,9 +630,90 @@ static void log_device_info(void) {
 
     uint8_t buffer[35] = { 0 };
     mvGetDeviceId(buffer, 34);
-    server_log("Device: %s", buffer);
-    server_log("   App: %s %s-%u", APP_NAME, APP_VERSION, BUILD_NUM);
+    LOG_INFO("Device: %s", buffer);
+    LOG_INFO("   App: %s %s-%u", APP_NAME, APP_VERSION, BUILD_NUM);
+}
+
+
+/**
+ * @brief Initialize I2C and, if it is present, the display,
+ *        then show the app name and version.
+ *
+ * Called from `task_led()`.
+ *
+ * @param icon_code: The icon to show first, eg. `NONE`.
+ */
+static void display_init(uint32_t icon_code) {
+
+    I2C_init();
+    boot_mark(BOOT_MILESTONE_I2C_INIT);
+    if (!use_i2c) return;
+
+    HT16K33_init(2);
+    boot_mark(BOOT_MILESTONE_DISPLAY_INIT);
+
+    // Set the weather icons
+    HT16K33_define_character("\x91\x42\x18\x3d\xbc\x18\x42\x89", CLEAR_DAY);
+    HT16K33_define_character("\x31\x7A\x78\xFA\xFC\xF9\x7A\x30", RAIN);
+    HT16K33_define_character("\x31\x7A\x78\xFA\xFC\xF9\x7A\x30", DRIZZLE);
+    HT16K33_define_character("\x28\x92\x54\x38\x38\x54\x92\x28", SNOW);
+    HT16K33_define_character("\x32\x7D\x7A\xFD\xFA\xFD\x7A\x35", SLEET);
+    HT16K33_define_character("\x28\x28\x28\x28\x28\xAA\xAA\x44", WIND);
+    HT16K33_define_character("\xAA\x55\xAA\x55\xAA\x55\xAA\x55", FOG);
+    HT16K33_define_character("\x30\x78\x78\xF8\xF8\xF8\x78\x30", CLOUDY);
+    HT16K33_define_character("\x30\x48\x48\x88\x88\x88\x48\x30", PARTLY_CLOUDY);
+    HT16K33_define_character("\x00\x00\x00\x0F\x38\xE0\x00\x00", THUNDERSTORM);
+    HT16K33_define_character("\x00\x40\x6C\xBE\xBB\xB1\x60\x40", TORNADO);
+    HT16K33_define_character("\x3C\x42\x81\xC3\xFF\xFF\x7E\x3C", CLEAR_NIGHT);
+    HT16K33_define_character("\x00\x00\x40\x9D\x90\x60\x00\x00", NONE);
+    boot_mark(BOOT_MILESTONE_GLYPHS);
+
+    // Show the 'no forecast' icon straight away, then the title
+    HT16K33_draw_def_char(icon_code);
+    HT16K33_draw();
+    boot_mark(BOOT_MILESTONE_FIRST_PIXEL);
+
+    char* title = malloc(42);
+    sprintf(title, "    %s %s    ", APP_NAME, APP_VERSION);
+    HT16K33_print(title, 75);
+    free(title);
+}
+
+
+#if ENABLE_FORECAST_CACHE == true
+/**
+ * @brief Show the forecast saved by the last run, unless it's more
+ *        than `FORECAST_CACHE_TTL_S` old.
+ */
+static void load_cached_forecast(void) {
+
+    ForecastCacheRecord record;
+    if (!forecast_cache_load(&record)) return;
+
+    uint64_t usec = 0;
+    mvGetWallTime(&usec);
+    uint32_t now = (uint32_t)(usec / 1000000);
+    if (now < record.timestamp || now - record.timestamp > FORECAST_CACHE_TTL_S) {
+        LOG_INFO("Cached forecast is stale");
+        return;
+    }
+
+    // Hold off polling until the forecast is as old as the minimum poll period
+    uint32_t age_s = now - record.timestamp;
+    Forecast cached = {
+        .timestamp = record.timestamp,
+        .temperature = (int16_t)record.temperature,
+        .location = FORECAST_LOCATION_CACHED,
+        .icon_code = (uint8_t)record.icon_code,
+        .valid = true
+    };
+
+    strncpy(cached.label, record.label, FORECAST_LABEL_LEN_B - 1);
+    forecast_publish(&cached);
+    poll_defer(age_s < POLL_MIN_PERIOD_S ? (POLL_MIN_PERIOD_S - age_s) * 1000 : 0);
+    LOG_INFO("Cached forecast: %s (code: %lu), %lu s old", record.label, record.icon_code, age_s);
 }
+#endif
 
 
 /**
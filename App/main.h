@@ -14,6 +14,7 @@
  * INCLUDES
  */
 #include <string.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -30,6 +31,7 @@
 
 // App includes
 #include "logging.h"
+#include "crashlog.h"
 #include "uart_logging.h"
 #include "ht16k33-matrix.h"
 #include "i2c.h"
@@ -37,8 +39,19 @@
 #include "network.h"
 #include "openweather.h"
 #include "cJSON.h"
+#include "json.h"
+#include "json_writer.h"
 #include "config.h"
 #include "shared.h"
+#include "diagnostics.h"
+#include "trace.h"
+#include "latency.h"
+#include "boot.h"
+#include "forecast_cache.h"
+#include "poll.h"
+#include "location.h"
+#include "forecast.h"
+#include "telemetry.h"
 
 
 /*
@@ -53,7 +66,6 @@
 #define     DEBUG_TASK_PAUSE_MS         1000
 #define     DEFAULT_TASK_PAUSE_MS       500
 
-#define     WEATHER_READ_PERIOD_MS      300000
 #define     CHANNEL_KILL_PERIOD_MS      15000
 
 
@@ -33,6 +33,8 @@ static volatile uint32_t    current_notification_index = 0;
 
 /**
  * @brief Configure and connect to the network.
+ *
+ * Blocks the calling task until the network is connected.
  */
 void net_open_network(void) {
 
@@ -66,10 +68,7 @@ void net_open_network(void) {
             }
 
             // ... or wait a short period before retrying
-            for (volatile unsigned i = 0; i < 50000; ++i) {
-                // No op
-                __asm("nop");
-            }
+            osDelay(NET_CHECK_PERIOD_MS);
         }
     }
 }
@@ -104,6 +103,20 @@ static void net_setup_notification_center(void) {
 }
 
 
+/**
+ * @brief Check whether the network is connected.
+ *
+ * @returns `true` if the network is connected, otherwise `false`.
+ */
+bool net_is_connected(void) {
+
+    enum MvNetworkStatus net_status = MV_NETWORKSTATUS_DELIBERATELYOFFLINE;
+    return (net_handles.network != 0 &&
+            mvGetNetworkStatus(net_handles.network, &net_status) == MV_STATUS_OKAY &&
+            net_status == MV_NETWORKSTATUS_CONNECTED);
+}
+
+
 /**
  * @brief Provide the current network handle.
  *
@@ -122,6 +135,8 @@ void TIM1_BRK_IRQHandler(void) {
 
     // Network notifications interrupt service handler
     // Add your own notification processing code here
+    TRACE_ISR_ENTER(TRACE_ISR_NETWORK_NC);
+    TRACE_ISR_EXIT(TRACE_ISR_NETWORK_NC);
 }
 
 
@@ -13,6 +13,7 @@
  * CONSTANTS
  */
 #define     NET_NC_BUFFER_SIZE_R                8
+#define     NET_CHECK_PERIOD_MS                 100
 
 
 #ifdef __cplusplus
@@ -25,6 +26,7 @@ extern "C" {
  */
 void            net_open_network(void);
 MvNetworkHandle net_get_handle(void);
+bool            net_is_connected(void);
 
 
 #ifdef __cplusplus
@@ -19,38 +19,49 @@ static bool OW_get_key(void);
  * GLOBALS
  */
 static char request_url[1024] = { 0 };
-static char api_key[33] = { 0 };
+static char api_key[CONFIG_VALUE_LEN_B] = { 0 };
 static bool got_key = false;
 
 /**
  * @brief Initialise the OpenWeather access data.
- *
- *
  */
-void OW_init(double lat, double lng) {
+void OW_init(void) {
 
     // Request the 'secret' API key
-    if (!got_key) got_key = config_get_secret(api_key, API_KEY_SECRET_NAME);
-
-    if (got_key) sprintf(request_url,
-                         "%s?lat=%.6f&lon=%.6f&appid=%s&exclude=minutely,hourly,daily,alerts&units=metric",
-                         FORECAST_BASE_URL,
-                         lat,
-                         lng,
-                         api_key);
+    if (!got_key) got_key = OW_get_key();
 }
 
 
 /**
- * @brief Issue an HTTP request to OpenWeather.
+ * @brief Issue an HTTP request to OpenWeather on the open channel.
+ *
+ * @param lat: The forecast location's latitude.
+ * @param lng: The forecast location's longitude.
  *
  * @returns Whether the request was issued (`true`) or not (`false`)
  */
-bool OW_request_forecast(void) {
+bool OW_request_forecast(double lat, double lng) {
 
     if (!got_key) got_key = OW_get_key();
-    if (got_key)  return (http_send_request(request_url) == MV_STATUS_OKAY);
-    return false;
+    if (!got_key) return false;
+
+    sprintf(request_url,
+            "%s?lat=%.6f&lon=%.6f&appid=%s&exclude=minutely,hourly,daily,alerts&units=metric",
+            FORECAST_BASE_URL,
+            lat,
+            lng,
+            api_key);
+    return (http_send_request("GET", request_url, NULL, 0) == MV_STATUS_OKAY);
+}
+
+
+/**
+ * @brief Discard the API key, eg. because it was rejected,
+ *        so that it is requested again before the next request.
+ */
+void OW_forget_key(void) {
+
+    got_key = false;
 }
 
 
@@ -40,8 +40,9 @@ extern "C" {
 /*
  * PROTOTYPES
  */
-void OW_init(double lat, double lng);
-bool OW_request_forecast(void);
+void OW_init(void);
+bool OW_request_forecast(double lat, double lng);
+void OW_forget_key(void);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,418 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static uint32_t poll_budget_floor_ms(void);
+static uint32_t poll_phase_ms(uint32_t span_ms);
+static uint32_t poll_align_ms(uint32_t delay_ms);
+static uint32_t poll_failure_delay_ms(void);
+static uint32_t poll_jitter_ms(uint32_t delay_ms);
+
+
+/*
+ * GLOBALS
+ */
+// Schedule settings
+static uint32_t min_period_ms = POLL_MIN_PERIOD_S * 1000;
+static uint32_t max_period_ms = POLL_MAX_PERIOD_S * 1000;
+static uint32_t daily_budget = POLL_DAILY_BUDGET;
+static bool     align_to_slots = POLL_ALIGN_TO_SLOTS;
+
+// This device's place in any polling period, as a fraction of 2^32
+static uint32_t device_phase = 0;
+
+// Schedule state. The first poll is due at once
+static uint32_t period_ms = POLL_MIN_PERIOD_S * 1000;
+static uint32_t next_tick = 0;
+static bool     in_progress = false;
+static uint32_t outcome = POLL_FAILURE_NONE;
+
+// Failure handling state
+static PollStats poll_stats = { 0 };
+static uint32_t breaker_open_ms = POLL_BREAKER_OPEN_S * 1000;
+static uint32_t jitter_state = 1;
+static const char* failure_names[POLL_FAILURE_COUNT] = {
+    "none", "transient", "rate limited", "auth", "client", "offline"
+};
+
+// The last forecast received, to detect changes
+static struct {
+    uint32_t    timestamp;
+    uint32_t    icon_code;
+    double      temperature;
+    bool        valid;
+} last_forecast = { 0 };
+
+// Requests made today, by UTC day, and per poll
+static uint32_t budget_day = 0;
+static uint32_t budget_used = 0;
+static uint32_t poll_requests = 1;
+
+
+/**
+ * @brief Set this device's polling phase and schedule the first poll.
+ *
+ * The phase is a hash of the device ID, so it is spread evenly
+ * across the fleet but the same at every boot.
+ */
+void poll_init(void) {
+
+    uint8_t device_id[35] = { 0 };
+    mvGetDeviceId(device_id, 34);
+
+    // FNV-1a
+    uint32_t hash = 2166136261UL;
+    for (uint32_t i = 0 ; i < 34 && device_id[i] != 0 ; ++i) {
+        hash = (hash ^ device_id[i]) * 16777619UL;
+    }
+
+    device_phase = hash;
+    next_tick = HAL_GetTick() + poll_phase_ms(POLL_BOOT_SPREAD_S * 1000);
+
+    // Seed the backoff jitter so devices failing together retry apart
+    jitter_state = (hash ^ HAL_GetTick()) | 1;
+}
+
+
+/**
+ * @brief Apply the polling schedule held in the config store, if any.
+ *
+ * The value of the per-device config item `poll-schedule` is
+ * `<min period s>,<max period s>,<requests per day>`, optionally
+ * followed by `,1` to align polls to wall-clock slots.
+ */
+void poll_configure(void) {
+
+    char value[65] = { 0 };
+    if (!config_get_value(value, POLL_CONFIG_KEY)) return;
+
+    unsigned min_s = 0;
+    unsigned max_s = 0;
+    unsigned budget = 0;
+    unsigned align = POLL_ALIGN_TO_SLOTS ? 1 : 0;
+    int count = sscanf(value, "%u,%u,%u,%u", &min_s, &max_s, &budget, &align);
+    if (count >= 3 && min_s > 0 && max_s >= min_s && max_s < 86400 && budget > 0) {
+        min_period_ms = min_s * 1000;
+        max_period_ms = max_s * 1000;
+        daily_budget = budget;
+        align_to_slots = (align != 0);
+        if (period_ms < min_period_ms) period_ms = min_period_ms;
+        if (period_ms > max_period_ms) period_ms = max_period_ms;
+        LOG_INFO("Poll schedule set to %u-%u s, %u per day%s", min_s, max_s, budget, align_to_slots ? ", aligned" : "");
+    } else {
+        LOG_WARN("Unknown poll schedule '%s'", value);
+    }
+}
+
+
+/**
+ * @brief Put off the first poll because we have a recent forecast.
+ *
+ * Devices restarted together will likely hold forecasts of the same
+ * age, so the poll is also spread across the whole minimum period.
+ *
+ * @param delay_ms: The time until the forecast is due a refresh.
+ */
+void poll_defer(uint32_t delay_ms) {
+
+    next_tick = HAL_GetTick() + delay_ms + poll_phase_ms(min_period_ms);
+}
+
+
+/**
+ * @brief Check whether a poll should be issued.
+ *
+ * @param tick: The current HAL tick.
+ *
+ * @returns `true` if a poll is due and none is in progress, otherwise `false`.
+ */
+bool poll_due(uint32_t tick) {
+
+    return !in_progress && (int32_t)(tick - next_tick) >= 0;
+}
+
+
+/**
+ * @brief Record that a poll has been issued.
+ *
+ * A poll issued while the circuit breaker is open is its probe.
+ *
+ * @param requests: The number of requests the poll will make,
+ *                  one per forecast location.
+ */
+void poll_started(uint32_t requests) {
+
+    in_progress = true;
+    outcome = POLL_FAILURE_TRANSIENT;
+    if (poll_stats.breaker_state == POLL_BREAKER_OPEN) {
+        poll_stats.breaker_state = POLL_BREAKER_HALF_OPEN;
+        LOG_INFO("Probing OpenWeather after %lu failures", poll_stats.consecutive_failures);
+    }
+
+    // Count the request against today's budget
+    uint64_t usec = 0;
+    mvGetWallTime(&usec);
+    uint32_t day = (uint32_t)(usec / 1000000 / 86400);
+    if (day != budget_day) {
+        budget_day = day;
+        budget_used = 0;
+    }
+
+    poll_requests = requests > 0 ? requests : 1;
+    budget_used += poll_requests;
+}
+
+
+/**
+ * @brief Record a poll's forecast, and adapt the period to it.
+ *
+ * Changing conditions bring the period back to the minimum. Otherwise
+ * it is stretched, and more so if OpenWeather has not updated the
+ * forecast since the last poll.
+ *
+ * @param timestamp:   The forecast's time, in Unix epoch seconds.
+ * @param icon_code:   The forecast's icon, eg. `RAIN`.
+ * @param temperature: The forecast's temperature.
+ */
+void poll_succeeded(uint32_t timestamp, uint32_t icon_code, double temperature) {
+
+    outcome = POLL_FAILURE_NONE;
+    if (!last_forecast.valid) {
+        period_ms = min_period_ms;
+    } else {
+        double delta = temperature - last_forecast.temperature;
+        if (icon_code != last_forecast.icon_code || delta >= POLL_CHANGE_TEMP_C || delta <= -POLL_CHANGE_TEMP_C) {
+            period_ms = min_period_ms;
+        } else if (timestamp == last_forecast.timestamp) {
+            period_ms += period_ms / 2;
+        } else {
+            period_ms += period_ms / 4;
+        }
+    }
+
+    last_forecast.timestamp = timestamp;
+    last_forecast.icon_code = icon_code;
+    last_forecast.temperature = temperature;
+    last_forecast.valid = true;
+}
+
+
+/**
+ * @brief Record why a poll failed.
+ *
+ * Polls that finish without a forecast or a recorded failure
+ * are counted as transient failures.
+ *
+ * @param failure: The failure class, eg. `POLL_FAILURE_RATE_LIMITED`.
+ */
+void poll_failed(uint32_t failure) {
+
+    if (in_progress && failure < POLL_FAILURE_COUNT) outcome = failure;
+}
+
+
+/**
+ * @brief Skip a due poll because the network is down.
+ *
+ * No request is made, so this does not count towards
+ * the budget, the backoff or the circuit breaker.
+ *
+ * @param tick: The current HAL tick.
+ */
+void poll_offline(uint32_t tick) {
+
+    poll_stats.failures[POLL_FAILURE_OFFLINE]++;
+    next_tick = tick + poll_jitter_ms(POLL_BACKOFF_BASE_S * 1000);
+}
+
+
+/**
+ * @brief Record that a poll's channel has closed, and schedule the next.
+ *
+ * @param tick: The current HAL tick.
+ */
+void poll_finished(uint32_t tick) {
+
+    if (!in_progress) return;
+    in_progress = false;
+
+    uint32_t delay_ms = 0;
+    if (outcome == POLL_FAILURE_NONE) {
+        poll_stats.successes++;
+        poll_stats.consecutive_failures = 0;
+        breaker_open_ms = POLL_BREAKER_OPEN_S * 1000;
+        if (poll_stats.breaker_state != POLL_BREAKER_CLOSED) {
+            poll_stats.breaker_state = POLL_BREAKER_CLOSED;
+            LOG_INFO("OpenWeather probe succeeded: polling resumed");
+        }
+
+        if (period_ms < min_period_ms) period_ms = min_period_ms;
+        if (period_ms > max_period_ms) period_ms = max_period_ms;
+        delay_ms = period_ms;
+
+        // Never poll faster than the day's remaining budget allows.
+        // Retries are left to the backoff and the circuit breaker,
+        // which bound them, so that their jitter is kept
+        uint32_t floor_ms = poll_budget_floor_ms();
+        if (delay_ms < floor_ms) delay_ms = floor_ms;
+        if (align_to_slots) delay_ms = poll_align_ms(delay_ms);
+    } else {
+        poll_stats.failures[outcome]++;
+        poll_stats.consecutive_failures++;
+        delay_ms = poll_failure_delay_ms();
+
+        // A spent budget still holds retries until midnight, with
+        // the jitter added on top so that devices don't all retry then
+        if (budget_used >= daily_budget) delay_ms = poll_budget_floor_ms() + poll_jitter_ms(POLL_BACKOFF_BASE_S * 1000);
+    }
+
+    next_tick = tick + delay_ms;
+    LOG_DEBUG("Next poll in %lu s (%lu of %lu requests used today)", delay_ms / 1000, budget_used, daily_budget);
+}
+
+
+/**
+ * @brief Classify a failed HTTP request.
+ *
+ * @param result:      The request's `MvHttpResult`.
+ * @param status_code: The response's HTTP status code.
+ *
+ * @returns The failure class, eg. `POLL_FAILURE_AUTH`.
+ */
+uint32_t poll_classify(uint32_t result, uint32_t status_code) {
+
+    if (result != MV_HTTPRESULT_OK) return POLL_FAILURE_TRANSIENT;
+    if (status_code == 429) return POLL_FAILURE_RATE_LIMITED;
+    if (status_code == 401 || status_code == 403) return POLL_FAILURE_AUTH;
+    if (status_code >= 400 && status_code < 500) return POLL_FAILURE_CLIENT;
+    return POLL_FAILURE_TRANSIENT;
+}
+
+
+/**
+ * @brief Get the polling counters and circuit breaker state.
+ *
+ * @param stats: The counters are written here.
+ */
+void poll_get_stats(PollStats* stats) {
+
+    *stats = poll_stats;
+}
+
+
+/**
+ * @brief Work out when to retry a failed poll, tripping
+ *        the circuit breaker if need be.
+ *
+ * @returns The delay in ms.
+ */
+static uint32_t poll_failure_delay_ms(void) {
+
+    // A failed probe re-opens the breaker for longer. Retrying won't fix
+    // auth or client errors, so these open it straight away
+    bool trip = false;
+    if (poll_stats.breaker_state == POLL_BREAKER_HALF_OPEN) {
+        breaker_open_ms = breaker_open_ms * 2 < POLL_BREAKER_MAX_OPEN_S * 1000 ? breaker_open_ms * 2 : POLL_BREAKER_MAX_OPEN_S * 1000;
+        trip = true;
+    } else if (outcome == POLL_FAILURE_AUTH || outcome == POLL_FAILURE_CLIENT || poll_stats.consecutive_failures >= POLL_BREAKER_THRESHOLD) {
+        trip = true;
+    }
+
+    if (trip) {
+        poll_stats.breaker_state = POLL_BREAKER_OPEN;
+        poll_stats.breaker_trips++;
+        LOG_WARN("OpenWeather polling paused for %lu s after %lu failures (last: %s)",
+                 breaker_open_ms / 1000, poll_stats.consecutive_failures, failure_names[outcome]);
+        return breaker_open_ms / 2 + poll_jitter_ms(breaker_open_ms / 2);
+    }
+
+    // Exponential backoff
+    uint32_t shift = poll_stats.consecutive_failures - 1;
+    uint32_t backoff_ms = POLL_BACKOFF_BASE_S * 1000;
+    backoff_ms = (shift < 16 && (backoff_ms << shift) < max_period_ms) ? backoff_ms << shift : max_period_ms;
+    if (outcome == POLL_FAILURE_RATE_LIMITED && backoff_ms < max_period_ms) backoff_ms = max_period_ms;
+    return poll_jitter_ms(backoff_ms);
+}
+
+
+/**
+ * @brief Add jitter to a delay.
+ *
+ * @param delay_ms: The delay.
+ *
+ * @returns A random value from half the delay up to the delay.
+ */
+static uint32_t poll_jitter_ms(uint32_t delay_ms) {
+
+    // xorshift32
+    jitter_state ^= jitter_state << 13;
+    jitter_state ^= jitter_state >> 17;
+    jitter_state ^= jitter_state << 5;
+
+    uint32_t half = delay_ms / 2;
+    return half + (half > 0 ? jitter_state % half : 0);
+}
+
+
+/**
+ * @brief Get the shortest period that spreads the polls the remaining
+ *        requests allow across the rest of the UTC day.
+ *
+ * @returns The period in ms. If the budget is spent, the time to midnight.
+ */
+static uint32_t poll_budget_floor_ms(void) {
+
+    uint64_t usec = 0;
+    mvGetWallTime(&usec);
+    uint32_t seconds_left = 86400 - (uint32_t)((usec / 1000000) % 86400);
+    uint32_t polls_left = budget_used < daily_budget ? (daily_budget - budget_used) / poll_requests : 0;
+    if (polls_left == 0) return seconds_left * 1000;
+    return (uint32_t)(((uint64_t)seconds_left * 1000) / polls_left);
+}
+
+
+/**
+ * @brief Get this device's offset within a span of time.
+ *
+ * @param span_ms: The span, eg. a polling period.
+ *
+ * @returns The offset in ms, from 0 to `span_ms - 1`.
+ */
+static uint32_t poll_phase_ms(uint32_t span_ms) {
+
+    return (uint32_t)(((uint64_t)device_phase * span_ms) >> 32);
+}
+
+
+/**
+ * @brief Move a poll onto this device's slot in the wall-clock period.
+ *
+ * Slots start at each multiple of the delay since the epoch, plus the
+ * device's phase, so polls across the fleet stay evenly spread however
+ * the devices' boot times bunch. The poll goes in the first slot at
+ * least half the delay away, so the delay averages out unchanged.
+ *
+ * @param delay_ms: The unaligned delay.
+ *
+ * @returns The aligned delay, from half to one and a half times `delay_ms`.
+ */
+static uint32_t poll_align_ms(uint32_t delay_ms) {
+
+    uint64_t usec = 0;
+    if (mvGetWallTime(&usec) != MV_STATUS_OKAY || delay_ms == 0) return delay_ms;
+
+    uint64_t now_ms = usec / 1000;
+    uint64_t earliest = now_ms + delay_ms / 2 - poll_phase_ms(delay_ms);
+    uint64_t slot = (earliest + delay_ms - 1) / delay_ms * delay_ms + poll_phase_ms(delay_ms);
+    return (uint32_t)(slot - now_ms);
+}
@@ -0,0 +1,97 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _POLL_H_
+#define _POLL_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Default polling bounds, daily request budget and slot alignment. Set
+// at runtime with the per-device config item `poll-schedule`:
+// `<min s>,<max s>,<per day>[,<align>]`
+#define     POLL_MIN_PERIOD_S               300
+#define     POLL_MAX_PERIOD_S               1800
+#define     POLL_DAILY_BUDGET               288
+#define     POLL_ALIGN_TO_SLOTS             false
+#define     POLL_CONFIG_KEY                 "poll-schedule"
+
+// The first poll after boot is spread across this window by device ID,
+// so a fleet restarted by a deployment does not poll all at once. If a
+// recent forecast is already shown, the whole minimum period is used
+#define     POLL_BOOT_SPREAD_S              60
+
+// A forecast differing from the last by this much, or by icon,
+// counts as a change in conditions
+#define     POLL_CHANGE_TEMP_C              1.0
+
+// Why a poll failed
+#define     POLL_FAILURE_NONE               0
+#define     POLL_FAILURE_TRANSIENT          1   // No response, timeout, 5xx or unusable body
+#define     POLL_FAILURE_RATE_LIMITED       2   // HTTP 429
+#define     POLL_FAILURE_AUTH               3   // HTTP 401 or 403
+#define     POLL_FAILURE_CLIENT             4   // Any other 4xx
+#define     POLL_FAILURE_OFFLINE            5   // Network down: no request made
+#define     POLL_FAILURE_COUNT              6
+
+// Failed polls are retried after an exponential backoff, with jitter,
+// starting from this. Rate limited polls wait at least the max. period
+#define     POLL_BACKOFF_BASE_S             30
+
+// The circuit breaker stops polling after this many failures in a row,
+// or at once on an auth or client error. After the open time, a single
+// probe is made: if it fails, the open time doubles
+#define     POLL_BREAKER_THRESHOLD          5
+#define     POLL_BREAKER_OPEN_S             1800
+#define     POLL_BREAKER_MAX_OPEN_S         21600
+
+#define     POLL_BREAKER_CLOSED             0
+#define     POLL_BREAKER_OPEN               1
+#define     POLL_BREAKER_HALF_OPEN          2
+
+
+/*
+ * STRUCTURES
+ */
+typedef struct {
+    uint32_t    successes;
+    uint32_t    failures[POLL_FAILURE_COUNT];
+    uint32_t    consecutive_failures;
+    uint32_t    breaker_trips;
+    uint32_t    breaker_state;
+} PollStats;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        poll_init(void);
+void        poll_configure(void);
+void        poll_defer(uint32_t delay_ms);
+bool        poll_due(uint32_t tick);
+void        poll_started(uint32_t requests);
+void        poll_succeeded(uint32_t timestamp, uint32_t icon_code, double temperature);
+void        poll_failed(uint32_t failure);
+void        poll_offline(uint32_t tick);
+void        poll_finished(uint32_t tick);
+uint32_t    poll_classify(uint32_t result, uint32_t status_code);
+void        poll_get_stats(PollStats* stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _POLL_H_
@@ -97,6 +97,8 @@ bool shared_setup_notification_center(void) {
  */
 void TIM8_BRK_IRQHandler(void) {
 
+    TRACE_ISR_ENTER(TRACE_ISR_SHARED_NC);
+
     // Check for readable data in the HTTP channel
     bool got_notification = false;
     volatile struct MvNotification notification = shared_notification_center[notification_index];
@@ -115,6 +117,7 @@ void TIM8_BRK_IRQHandler(void) {
         // HTTP channel notifications
         case TAG_CHANNEL_HTTP:
             if (notification.event_type == MV_EVENTTYPE_CHANNELDATAREADABLE) {
+                latency_mark(LATENCY_LOCATION_CURRENT, LATENCY_STAGE_DATA_READABLE);
                 received_request = true;
                 got_notification = true;
             }
@@ -149,4 +152,6 @@ void TIM8_BRK_IRQHandler(void) {
         // See https://www.twilio.com/docs/iot/microvisor/microvisor-notifications#buffer-overruns
         notification.event_type = 0;
     }
+
+    TRACE_ISR_EXIT(TRACE_ISR_SHARED_NC);
  }
@@ -0,0 +1,343 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     telemetry_timer_callback(void *arg);
+static void     telemetry_sample(void);
+static int32_t  telemetry_write_batch(const TelemetrySample* samples, uint32_t count);
+static uint16_t telemetry_clamp(uint32_t value);
+
+
+/*
+ * GLOBALS
+ */
+static osTimerId_t telemetry_timer = NULL;
+
+// Samples awaiting upload, by sequence number: `written` is the
+// next to be taken, `oldest` the first not yet uploaded
+static TelemetrySample      ring[TELEMETRY_RING_SIZE];
+static volatile uint32_t    written = 0;
+static volatile uint32_t    oldest = 0;
+static volatile uint32_t    dropped = 0;
+
+// The batch being uploaded, copied out of the ring
+static TelemetrySample      batch[TELEMETRY_RING_SIZE];
+static uint32_t             batch_end = 0;
+static char                 body[TELEMETRY_BODY_MAX_B];
+
+// Running totals, each only written by one task. The sampler
+// keeps the values it last saw to work out each period's counts
+static volatile uint32_t    total_frames = 0;
+static volatile uint32_t    total_i2c_errors = 0;
+static volatile uint32_t    total_requests = 0;
+static volatile uint32_t    last_request_ms = 0;
+static volatile uint32_t    last_parse_us = 0;
+static uint32_t             sampled_frames = 0;
+static uint32_t             sampled_i2c_errors = 0;
+static uint32_t             sampled_requests = 0;
+
+// Upload schedule
+static char                 upload_url[TELEMETRY_URL_MAX_B] = { 0 };
+static uint32_t             upload_period_ms = TELEMETRY_UPLOAD_PERIOD_S * 1000;
+static uint32_t             next_tick = 0;
+
+// The batch's per-sample values, uploaded as one array each
+static const struct {
+    const char* key;
+    uint8_t     offset;
+    uint8_t     size;
+} columns[] = {
+    { "connected",  offsetof(TelemetrySample, connected),   1 },
+    { "request_ms", offsetof(TelemetrySample, request_ms),  2 },
+    { "parse_us",   offsetof(TelemetrySample, parse_us),    2 },
+    { "requests",   offsetof(TelemetrySample, requests),    2 },
+    { "heap_min",   offsetof(TelemetrySample, heap_min_b),  2 },
+    { "stack_min",  offsetof(TelemetrySample, stack_min_w), 2 },
+    { "i2c_errors", offsetof(TelemetrySample, i2c_errors),  2 },
+    { "frames",     offsetof(TelemetrySample, frames),      2 }
+};
+
+
+/**
+ * @brief Start taking telemetry samples.
+ *
+ * Call after `osKernelInitialize()` as this creates a CMSIS timer.
+ */
+void telemetry_init(void) {
+
+    if (TELEMETRY_SAMPLE_PERIOD_S == 0) return;
+
+    next_tick = HAL_GetTick() + upload_period_ms;
+    telemetry_timer = osTimerNew(telemetry_timer_callback, osTimerPeriodic, NULL, NULL);
+    if (telemetry_timer == NULL || osTimerStart(telemetry_timer, TELEMETRY_SAMPLE_PERIOD_S * 1000) != osOK) {
+        server_error("Could not start telemetry timer");
+    }
+}
+
+
+/**
+ * @brief Apply the telemetry endpoint and upload period
+ *        held in the config store, if any.
+ *
+ * The value of the per-device config item `telemetry-url` is the
+ * URL batches are POSTed to. The value of `telemetry-period` is
+ * the upload period in seconds.
+ */
+void telemetry_configure(void) {
+
+    if (TELEMETRY_SAMPLE_PERIOD_S == 0) return;
+
+    char value[65] = { 0 };
+    if (config_get_value(value, TELEMETRY_URL_CONFIG_KEY)) {
+        if (strncmp(value, "https://", 8) == 0) {
+            strcpy(upload_url, value);
+            LOG_INFO("Telemetry endpoint set to %s", upload_url);
+        } else {
+            LOG_WARN("Unknown telemetry endpoint '%s'", value);
+        }
+    }
+
+    memset(value, 0x00, sizeof(value));
+    if (config_get_value(value, TELEMETRY_PERIOD_CONFIG_KEY)) {
+        unsigned period_s = 0;
+        if (sscanf(value, "%u", &period_s) == 1 && period_s >= TELEMETRY_MIN_UPLOAD_PERIOD_S && period_s < 86400) {
+            upload_period_ms = period_s * 1000;
+            next_tick = HAL_GetTick() + upload_period_ms;
+            LOG_INFO("Telemetry upload period set to %u s", period_s);
+        } else {
+            LOG_WARN("Unknown telemetry upload period '%s'", value);
+        }
+    }
+}
+
+
+/**
+ * @brief Is it time to upload the samples taken so far?
+ *
+ * @param tick: The current HAL tick.
+ *
+ * @returns `true` if there are samples to upload and somewhere to upload them.
+ */
+bool telemetry_due(uint32_t tick) {
+
+    return upload_url[0] != 0 && written != oldest && (int32_t)(tick - next_tick) >= 0;
+}
+
+
+/**
+ * @brief POST the samples not yet uploaded as a single JSON batch.
+ *
+ * Each metric is sent as an array with a value per sample, oldest first,
+ * alongside the first sample's time and the sample period.
+ *
+ * @returns Whether the request was issued (`true`) or not (`false`)
+ */
+bool telemetry_send(void) {
+
+    // Copy the samples out, so the ring can take more while we upload
+    // The sampler may move `oldest` on at any time, so work from a copy
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t base = oldest;
+    uint32_t count = written - base;
+    for (uint32_t i = 0 ; i < count ; ++i) {
+        batch[i] = ring[(base + i) & (TELEMETRY_RING_SIZE - 1)];
+    }
+    __set_PRIMASK(primask);
+
+    // If the batch won't fit, send its newer half
+    uint32_t first = base;
+    int32_t length = telemetry_write_batch(batch, count);
+    while (length < 0 && count > 1) {
+        uint32_t skip = count / 2;
+        first += skip;
+        count -= skip;
+        length = telemetry_write_batch(&batch[first - base], count);
+    }
+
+    if (length < 0) {
+        server_error("Telemetry batch too large");
+        return false;
+    }
+
+    batch_end = first + count;
+    server_log("Telemetry: sending %lu samples (%li B)", count, length);
+    return (http_send_request("POST", upload_url, body, (uint32_t)length) == MV_STATUS_OKAY);
+}
+
+
+/**
+ * @brief Record the outcome of an upload and schedule the next.
+ *
+ * Samples are only released once the endpoint accepts them, so
+ * a failed batch is sent again, with newer samples, next time.
+ *
+ * @param accepted: Whether the endpoint accepted the batch.
+ * @param tick:     The current HAL tick.
+ */
+void telemetry_finished(bool accepted, uint32_t tick) {
+
+    if (accepted) {
+        // Samples may have been dropped from the ring meanwhile
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        if ((int32_t)(batch_end - oldest) > 0) oldest = batch_end;
+        __set_PRIMASK(primask);
+        LOG_DEBUG("Telemetry uploaded (%lu samples dropped since boot)", dropped);
+    } else {
+        LOG_WARN("Telemetry upload failed");
+    }
+
+    next_tick = tick + upload_period_ms;
+}
+
+
+/**
+ * @brief Record a forecast request's timings.
+ *
+ * Called from the forecast parse task.
+ *
+ * @param request_ms: Time from sending the request to reading the response.
+ * @param parse_us:   Time taken to parse the response.
+ */
+void telemetry_record_request(uint32_t request_ms, uint32_t parse_us) {
+
+    last_request_ms = request_ms;
+    last_parse_us = parse_us;
+    total_requests++;
+}
+
+
+/**
+ * @brief Count a frame written to the display.
+ *
+ * Called from the I2C bus manager task.
+ */
+void telemetry_count_frame(void) {
+
+    total_frames++;
+}
+
+
+/**
+ * @brief Count a failed I2C transfer.
+ *
+ * Called from the I2C bus manager task.
+ */
+void telemetry_count_i2c_error(void) {
+
+    total_i2c_errors++;
+}
+
+
+/**
+ * @brief Take a sample and add it to the ring, dropping
+ *        the oldest sample if the ring is full.
+ */
+static void telemetry_sample(void) {
+
+    TelemetrySample sample;
+    memset(&sample, 0x00, sizeof(TelemetrySample));
+
+    uint64_t usec = 0;
+    mvGetWallTime(&usec);
+    sample.timestamp = (uint32_t)(usec / 1000000);
+    sample.connected = net_is_connected() ? 1 : 0;
+    sample.request_ms = telemetry_clamp(last_request_ms);
+    sample.parse_us = telemetry_clamp(last_parse_us);
+    sample.heap_min_b = telemetry_clamp(xPortGetMinimumEverFreeHeapSize());
+    sample.stack_min_w = telemetry_clamp(diag_stack_headroom());
+
+    uint32_t value = total_requests;
+    sample.requests = telemetry_clamp(value - sampled_requests);
+    sampled_requests = value;
+
+    value = total_i2c_errors;
+    sample.i2c_errors = telemetry_clamp(value - sampled_i2c_errors);
+    sampled_i2c_errors = value;
+
+    value = total_frames;
+    sample.frames = telemetry_clamp(value - sampled_frames);
+    sampled_frames = value;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    ring[written & (TELEMETRY_RING_SIZE - 1)] = sample;
+    written++;
+    if (written - oldest > TELEMETRY_RING_SIZE) {
+        oldest = written - TELEMETRY_RING_SIZE;
+        dropped++;
+    }
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Serialise a batch of samples into the request body.
+ *
+ * @param samples: The samples, oldest first.
+ * @param count:   The number of samples.
+ *
+ * @returns The length of the body, or -1 if it does not fit.
+ */
+static int32_t telemetry_write_batch(const TelemetrySample* samples, uint32_t count) {
+
+    uint8_t device_id[35] = { 0 };
+    mvGetDeviceId(device_id, 34);
+
+    JsonWriter writer;
+    json_writer_init(&writer, body, sizeof(body), NULL, NULL);
+    json_write_object_begin(&writer, NULL);
+    json_write_string(&writer, "device", (char *)device_id);
+    json_write_int(&writer, "from", samples[0].timestamp);
+    json_write_int(&writer, "period", TELEMETRY_SAMPLE_PERIOD_S);
+    json_write_int(&writer, "dropped", dropped);
+
+    for (uint32_t i = 0 ; i < sizeof(columns) / sizeof(columns[0]) ; ++i) {
+        json_write_array_begin(&writer, columns[i].key);
+        for (uint32_t j = 0 ; j < count ; ++j) {
+            const uint8_t* field = (const uint8_t*)&samples[j] + columns[i].offset;
+            json_write_int(&writer, NULL, columns[i].size == 1 ? *field : *(const uint16_t*)field);
+        }
+
+        json_write_array_end(&writer);
+    }
+
+    json_write_object_end(&writer);
+    return json_writer_finish(&writer);
+}
+
+
+/**
+ * @brief Limit a value to the range of a sample field.
+ *
+ * @param value: The value.
+ *
+ * @returns The value, or 65535 if it is larger.
+ */
+static uint16_t telemetry_clamp(uint32_t value) {
+
+    return value > UINT16_MAX ? UINT16_MAX : (uint16_t)value;
+}
+
+
+/**
+ * @brief A CMSIS/FreeRTOS timer callback function.
+ *
+ * @param arg: Pointer to and argument value passed by the timer controller.
+ *             Unused here.
+ */
+static void telemetry_timer_callback(void *arg) {
+
+    telemetry_sample();
+}
@@ -0,0 +1,81 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Set in the root `CMakeLists.txt`. Zero disables telemetry
+#ifndef     TELEMETRY_SAMPLE_PERIOD_S
+#define     TELEMETRY_SAMPLE_PERIOD_S       60
+#endif
+
+// Samples held until they are uploaded. When the ring is full,
+// the oldest sample is dropped
+#define     TELEMETRY_RING_SIZE             16
+
+// Default upload period. Set at runtime with the per-device config
+// item `telemetry-period`. Nothing is uploaded until the per-device
+// config item `telemetry-url` is set
+#define     TELEMETRY_UPLOAD_PERIOD_S       900
+#define     TELEMETRY_MIN_UPLOAD_PERIOD_S   60
+#define     TELEMETRY_PERIOD_CONFIG_KEY     "telemetry-period"
+#define     TELEMETRY_URL_CONFIG_KEY        "telemetry-url"
+
+// Room for a full ring of samples. A batch that does not fit
+// is cut down to its newest samples
+#define     TELEMETRY_BODY_MAX_B            1024
+#define     TELEMETRY_URL_MAX_B             65
+
+
+/*
+ * STRUCTURES
+ */
+// One sample. Counts are over the sample period. `request_ms`
+// and `parse_us` are the latest forecast request's
+typedef struct {
+    uint32_t    timestamp;
+    uint16_t    request_ms;
+    uint16_t    parse_us;
+    uint16_t    heap_min_b;
+    uint16_t    stack_min_w;
+    uint16_t    requests;
+    uint16_t    i2c_errors;
+    uint16_t    frames;
+    uint8_t     connected;
+    uint8_t     reserved;
+} TelemetrySample;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        telemetry_init(void);
+void        telemetry_configure(void);
+bool        telemetry_due(uint32_t tick);
+bool        telemetry_send(void);
+void        telemetry_finished(bool accepted, uint32_t tick);
+void        telemetry_record_request(uint32_t request_ms, uint32_t parse_us);
+void        telemetry_count_frame(void);
+void        telemetry_count_i2c_error(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _TELEMETRY_H_
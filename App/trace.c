@@ -0,0 +1,95 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+#if ENABLE_TRACE == true
+
+/*
+ * GLOBALS
+ */
+// The trace ring. Not static so that it can be located by name
+// and dumped over a remote debugging session -- see README.md
+TraceBuffer trace_buffer = { 0 };
+
+static bool use_cyccnt = false;
+
+
+/**
+ * @brief Prepare the trace ring.
+ *
+ * Call as early as possible: records made before this are kept,
+ * but their timestamps may be in the wrong units.
+ */
+void trace_init(void) {
+
+    use_cyccnt = diag_cycle_counter_start();
+
+    trace_buffer.magic = TRACE_MAGIC;
+    trace_buffer.version = TRACE_VERSION;
+    trace_buffer.clock_hz = use_cyccnt ? SystemCoreClock : 1000;
+    trace_buffer.capacity = TRACE_BUFFER_SIZE_R;
+}
+
+
+/**
+ * @brief Add a record to the trace ring, overwriting the oldest.
+ *
+ * Safe to call from tasks and ISRs.
+ *
+ * @param event: The record type, eg. `TRACE_EVENT_SPAN_BEGIN`.
+ * @param id:    The span, ISR or task ID.
+ */
+void trace_record(uint8_t event, uint8_t id) {
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    TraceRecord *record = &trace_buffer.records[trace_buffer.write_index & (TRACE_BUFFER_SIZE_R - 1)];
+    record->timestamp = use_cyccnt ? DWT->CYCCNT : HAL_GetTick();
+    record->event = event;
+    record->id = id;
+    trace_buffer.write_index++;
+
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Record a task switch-in.
+ *
+ * Called by FreeRTOS via `traceTASK_SWITCHED_IN()`.
+ *
+ * @param number: The task's trace facility number.
+ * @param name:   The task's name. Stored the first time a task is seen.
+ */
+void trace_task_switched_in(uint32_t number, const char *name) {
+
+    if (number < TRACE_MAX_TASKS && trace_buffer.task_names[number][0] == 0) {
+        strncpy(trace_buffer.task_names[number], name, TRACE_TASK_NAME_LEN_B - 1);
+    }
+
+    trace_record(TRACE_EVENT_TASK_IN, (uint8_t)number);
+}
+
+
+/**
+ * @brief Record a task switch-out.
+ *
+ * Called by FreeRTOS via `traceTASK_SWITCHED_OUT()`.
+ *
+ * @param number: The task's trace facility number.
+ */
+void trace_task_switched_out(uint32_t number) {
+
+    trace_record(TRACE_EVENT_TASK_OUT, (uint8_t)number);
+}
+
+
+#endif      // ENABLE_TRACE
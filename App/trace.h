@@ -0,0 +1,106 @@
+/**
+ *
+ * Microvisor Weather Device Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     TRACE_BUFFER_SIZE_R             512     // NOTE Size in records, not bytes. Must be a power of two
+#define     TRACE_MAX_TASKS                 16
+#define     TRACE_TASK_NAME_LEN_B           16
+#define     TRACE_MAGIC                     0x5254564D  // 'MVTR'
+#define     TRACE_VERSION                   1
+
+// Record types
+#define     TRACE_EVENT_TASK_IN             1
+#define     TRACE_EVENT_TASK_OUT            2
+#define     TRACE_EVENT_ISR_ENTER           3
+#define     TRACE_EVENT_ISR_EXIT            4
+#define     TRACE_EVENT_SPAN_BEGIN          5
+#define     TRACE_EVENT_SPAN_END            6
+#define     TRACE_EVENT_MARK                7
+
+// ISR IDs
+#define     TRACE_ISR_SHARED_NC             1
+#define     TRACE_ISR_NETWORK_NC            2
+
+// Span and mark IDs
+#define     TRACE_SPAN_HTTP_RESPONSE        1
+#define     TRACE_SPAN_DISPLAY_PRINT        2
+#define     TRACE_SPAN_POST_LOG             3
+#define     TRACE_SPAN_HTTP_SEND            4
+#define     TRACE_SPAN_DISPLAY_DRAW         5
+#define     TRACE_MARK_NEW_FORECAST         6
+
+
+/*
+ * MACROS
+ */
+#if ENABLE_TRACE == true
+#define     TRACE_SPAN_BEGIN(id)            trace_record(TRACE_EVENT_SPAN_BEGIN, (id))
+#define     TRACE_SPAN_END(id)              trace_record(TRACE_EVENT_SPAN_END, (id))
+#define     TRACE_ISR_ENTER(id)             trace_record(TRACE_EVENT_ISR_ENTER, (id))
+#define     TRACE_ISR_EXIT(id)              trace_record(TRACE_EVENT_ISR_EXIT, (id))
+#define     TRACE_MARK(id)                  trace_record(TRACE_EVENT_MARK, (id))
+#else
+#define     TRACE_SPAN_BEGIN(id)
+#define     TRACE_SPAN_END(id)
+#define     TRACE_ISR_ENTER(id)
+#define     TRACE_ISR_EXIT(id)
+#define     TRACE_MARK(id)
+#endif
+
+
+/*
+ * STRUCTURES
+ */
+typedef struct {
+    uint32_t    timestamp;          // Clock cycles, or ms if `clock_hz` is 1000
+    uint8_t     event;
+    uint8_t     id;
+    uint16_t    reserved;
+} TraceRecord;
+
+/**
+ * The ring's layout is read by `tools/trace_to_chrome.py`,
+ * so any change must be matched there and `TRACE_VERSION` bumped.
+ */
+typedef struct {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    clock_hz;
+    uint32_t    capacity;
+    uint32_t    write_index;        // Total records written -- not wrapped
+    char        task_names[TRACE_MAX_TASKS][TRACE_TASK_NAME_LEN_B];
+    TraceRecord records[TRACE_BUFFER_SIZE_R];
+} TraceBuffer;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        trace_init(void);
+void        trace_record(uint8_t event, uint8_t id);
+void        trace_task_switched_in(uint32_t number, const char *name);
+void        trace_task_switched_out(uint32_t number);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _TRACE_H_
@@ -9,8 +9,23 @@
 #include "main.h"
 
 
+/*
+ * STATIC PROTOTYPES
+ */
+static void log_uart_transmit(const char* data, uint32_t length);
+
+
+/*
+ * GLOBALS
+ */
 static UART_HandleTypeDef log_uart;
 
+// The timestamp prefix, "2022-05-10 13:30:58.XXX ". The date and
+// time are only reformatted when the second changes
+static char     timestamp[UART_LOG_TIMESTAMP_MAX_LEN_B] = { 0 };
+static uint32_t timestamp_ms_offset = 0;
+static time_t   timestamp_sec = -1;
+
 
 /**
  * @brief Configure STM32U585 UART2.
@@ -80,42 +95,67 @@ void HAL_UART_MspInit(UART_HandleTypeDef *uart) {
  * @brief Output a UART-friendly log string, ie. one with
  *        RETURN+NEWLINE in place of NEWLINE.
  *
+ * The message is sent straight from the caller's buffer, in runs
+ * between newlines, after the timestamp.
+ *
  * @param buffer: Source string.
- * @param length: String character count.
  */
 void log_uart_output(char* buffer) {
 
-    static char uart_buffer[UART_LOG_TIMESTAMP_MAX_LEN_B + LOG_MESSAGE_MAX_LEN_B + 3] = {0};
-
     uint64_t usec = 0;
     time_t sec = 0;
-    time_t msec = 0;
+    uint32_t msec = 0;
 
     enum MvStatus status = mvGetWallTime(&usec);
     if (status == MV_STATUS_OKAY) {
         // Get the second and millisecond times
-        sec = (time_t)usec / 1000000;
-        msec = (time_t)usec / 1000;
+        sec = (time_t)(usec / 1000000);
+        msec = (uint32_t)((usec / 1000) % 1000);
     }
 
-    // Write time string as "2022-05-10 13:30:58.XXX "
-    strftime(uart_buffer, 64, "%F %T.XXX ", gmtime(&sec));
-    // Insert the millisecond time over the XXX
-    sprintf(&uart_buffer[20], "%03u ", (unsigned)(msec % 1000));
-    uint32_t length = strlen(uart_buffer);
-
-    // Write the timestamp to the message
-    sprintf(&uart_buffer[length], "%s\n", buffer);
-
-    // Send uart_buffer to the UART
-    const char nls[2] = "\r\n";
-    char *buf_ptr = uart_buffer;
-    while(*buf_ptr != 0) {
-        if (*buf_ptr == '\n') {
-            HAL_UART_Transmit(&log_uart, (uint8_t*)nls, 2, 100);
-            buf_ptr++;
-        } else {
-            HAL_UART_Transmit(&log_uart, (uint8_t*)buf_ptr++, 1, 100);
+    // Write time string as "2022-05-10 13:30:58." -- but only if
+    // the second has changed since the last message
+    if (sec != timestamp_sec) {
+        strftime(timestamp, sizeof(timestamp) - 4, "%F %T.", gmtime(&sec));
+        timestamp_ms_offset = strlen(timestamp);
+        timestamp_sec = sec;
+    }
+
+    // Write the millisecond time after it
+    timestamp[timestamp_ms_offset]     = '0' + (msec / 100);
+    timestamp[timestamp_ms_offset + 1] = '0' + (msec / 10) % 10;
+    timestamp[timestamp_ms_offset + 2] = '0' + msec % 10;
+    timestamp[timestamp_ms_offset + 3] = ' ';
+    log_uart_transmit(timestamp, timestamp_ms_offset + 4);
+
+    // Send the message, swapping each NEWLINE for RETURN+NEWLINE
+    const char *run = buffer;
+    while (1) {
+        const char *newline = strchr(run, '\n');
+        if (newline == NULL) {
+            log_uart_transmit(run, strlen(run));
+            break;
         }
+
+        log_uart_transmit(run, newline - run);
+        log_uart_transmit("\r\n", 2);
+        run = newline + 1;
     }
+
+    log_uart_transmit("\r\n", 2);
+}
+
+
+/**
+ * @brief Send bytes to the UART.
+ *
+ * @param data:   The bytes to send.
+ * @param length: The number of bytes.
+ */
+static void log_uart_transmit(const char* data, uint32_t length) {
+
+    if (length == 0) return;
+
+    // Allow 1ms per 10 bytes at 115,200bps, plus a margin
+    HAL_UART_Transmit(&log_uart, (const uint8_t*)data, (uint16_t)length, 10 + length / 10);
 }
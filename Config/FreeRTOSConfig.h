@@ -50,6 +50,7 @@
 /* Ensure definitions are only used by the compiler, and not by the assembler. */
 #if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
   #include <stdint.h>
+  #include <stdbool.h>
   extern uint32_t SystemCoreClock;
 #endif
 /*-------------------- STM32U5 specific defines -------------------*/
@@ -68,7 +69,7 @@
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 56 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)2048)
-#define configTOTAL_HEAP_SIZE                    ((size_t)16384)
+#define configTOTAL_HEAP_SIZE                    ((size_t)22528)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY                 1
 #define configUSE_16_BIT_TICKS                   0
@@ -143,11 +144,34 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 /* Normal assert() semantics without relying on the provision of an assert.h
 header file. */
 /* USER CODE BEGIN 1 */
-#define configASSERT( x ) if ((x) == 0) {taskDISABLE_INTERRUPTS(); for( ;; );} 
+/* Failures are kept for the next boot to report -- see App/crashlog.c */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+  extern void crashlog_rtos_assert(const char *file, uint32_t line);
+#endif
+#define configASSERT( x ) if ((x) == 0) {taskDISABLE_INTERRUPTS(); crashlog_rtos_assert(__FILE__, __LINE__); for( ;; );} 
 /* USER CODE END 1 */
 
 /* USER CODE BEGIN Defines */   	      
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+
+/* Run-time stats for per-task CPU usage reports -- see App/diagnostics.c */
+#define configGENERATE_RUN_TIME_STATS            1
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+  extern void diag_runtime_counter_init(void);
+  extern uint32_t diag_runtime_counter_value(void);
+#endif
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() diag_runtime_counter_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()         diag_runtime_counter_value()
+
+/* Scheduler tracing -- see App/trace.c */
+#if ENABLE_TRACE == true
+  #if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+    extern void trace_task_switched_in(uint32_t number, const char *name);
+    extern void trace_task_switched_out(uint32_t number);
+  #endif
+  #define traceTASK_SWITCHED_IN()  trace_task_switched_in(pxCurrentTCB->uxTCBNumber, pxCurrentTCB->pcTaskName)
+  #define traceTASK_SWITCHED_OUT() trace_task_switched_out(pxCurrentTCB->uxTCBNumber)
+#endif
 /* USER CODE END Defines */ 
 
 #endif /* FREERTOS_CONFIG_H */
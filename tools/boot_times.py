@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+#
+# Microvisor Weather Device Demo
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+# Summarise boot milestone records (see `boot_report()` in App/boot.c)
+# from one or more logs, and optionally check them against a baseline
+# so that startup time regressions show up between builds. Decode binary
+# logs with log_decode.py first.
+#
+# Usage: boot_times.py [log file ...]                      Summarise logs, or stdin
+#        boot_times.py --save <baseline> [log file ...]    Also save the medians as JSON
+#        boot_times.py --check <baseline> [log file ...]   Exit 1 if a median is >10% slower
+
+import json
+import re
+import sys
+
+RECORD = re.compile(r"Boot at \d+: (.*)")
+MILESTONE = re.compile(r"(\w+) (-?\d+)/(-?\d+)")
+TOLERANCE = 1.10
+
+
+def read_records(sources):
+    records = []
+    for source in sources:
+        for line in source:
+            match = RECORD.search(line)
+            if match:
+                records.append({name: int(tick) for name, tick, _ in MILESTONE.findall(match.group(1))})
+    return records
+
+
+def percentile(values, percent):
+    values = sorted(values)
+    return values[min(len(values) - 1, (len(values) * percent) // 100)]
+
+
+def main():
+    args = sys.argv[1:]
+    mode = None
+    baseline_path = None
+    if args and args[0] in ("--save", "--check"):
+        if len(args) < 2:
+            sys.exit("Usage: %s [--save|--check <baseline>] [log file ...]" % sys.argv[0])
+        mode, baseline_path, args = args[0], args[1], args[2:]
+
+    sources = [open(path, encoding="utf-8", errors="replace") for path in args] or [sys.stdin]
+    records = read_records(sources)
+    if not records:
+        sys.exit("No boot records found")
+
+    # Milestones not reached are logged as -1, so are left out
+    print("%d boot(s), ms since HAL_Init by tick" % len(records))
+    print("%-10s %8s %8s %8s" % ("milestone", "p50", "p90", "max"))
+    medians = {}
+    for name in records[0]:
+        values = [record[name] for record in records if record.get(name, -1) >= 0]
+        if not values:
+            continue
+        medians[name] = percentile(values, 50)
+        print("%-10s %8d %8d %8d" % (name, medians[name], percentile(values, 90), max(values)))
+
+    if mode == "--save":
+        with open(baseline_path, "w") as baseline_file:
+            json.dump(medians, baseline_file, indent=2)
+    elif mode == "--check":
+        with open(baseline_path) as baseline_file:
+            baseline = json.load(baseline_file)
+        slower = [name for name in medians if name in baseline and medians[name] > baseline[name] * TOLERANCE]
+        for name in slower:
+            print("Regression: %s p50 %d ms, baseline %d ms" % (name, medians[name], baseline[name]))
+        sys.exit(1 if slower else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+#
+# Microvisor Weather Device Demo
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+# Re-inflate binary log records (see `log_binary()` in App/logging.c)
+# to text. Lines without binary records are passed through unchanged.
+#
+# The dictionary is the `log_formats` section extracted at build time:
+# build/App/mv-weather-device-demo.logfmt. A format string's ID is its
+# offset in that file.
+#
+# Usage: log_decode.py <dictionary> [log file]     Decode a log, or stdin
+#        log_decode.py --dump <dictionary>         Print the dictionary as JSON
+
+import base64
+import json
+import re
+import struct
+import sys
+
+LOG_BINARY_MARKER = "#L:"
+CRASHLOG_TRUNCATED_MARK = "..."
+LEVEL_PREFIXES = ["[-----] ", "[ERROR] ", "[WARN]  ", "[INFO]  ", "[DEBUG] "]
+SPEC = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|L|q|j|z|t)?([diuxXocpfFeEgGaAs%])")
+
+
+class Record:
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            if self.pos >= len(self.data):
+                raise EOFError
+            byte = self.data[self.pos]
+            self.pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if byte & 0x80 == 0:
+                return value
+
+    def signed(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def double(self):
+        if self.pos + 8 > len(self.data):
+            raise EOFError
+        value = struct.unpack_from("<d", self.data, self.pos)[0]
+        self.pos += 8
+        return value
+
+    def string(self):
+        length = self.varint()
+        value = self.data[self.pos:self.pos + length]
+        self.pos += length
+        return value.decode("utf-8", "replace")
+
+
+def load_dictionary(path):
+    with open(path, "rb") as section:
+        return section.read()
+
+
+def format_at(dictionary, ident):
+    end = dictionary.find(b"\0", ident)
+    return dictionary[ident:end if end >= 0 else None].decode("utf-8", "replace")
+
+
+def dump_dictionary(dictionary):
+    # Strings are NUL terminated and may be padded for alignment
+    entries = {}
+    offset = 0
+    while offset < len(dictionary):
+        if dictionary[offset] != 0:
+            text = format_at(dictionary, offset)
+            entries[offset] = text
+            offset += len(text.encode("utf-8"))
+        offset += 1
+    return entries
+
+
+def render(format_string, record):
+    out = []
+    last = 0
+    try:
+        for spec in SPEC.finditer(format_string):
+            out.append(format_string[last:spec.start()])
+            last = spec.end()
+            flags, width, precision, _, conversion = spec.groups()
+            if conversion == "%":
+                out.append("%")
+                continue
+            if width == "*":
+                width = str(record.varint())
+            if precision == "*":
+                precision = str(record.varint())
+            py_spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+            if conversion in "di":
+                out.append((py_spec + "d") % record.signed())
+            elif conversion in "uxXo":
+                out.append((py_spec + ("d" if conversion == "u" else conversion)) % record.varint())
+            elif conversion == "c":
+                out.append((py_spec + "c") % record.varint())
+            elif conversion == "p":
+                out.append("0x%x" % record.varint())
+            elif conversion in "fFeEgG":
+                out.append((py_spec + conversion) % record.double())
+            elif conversion in "aA":
+                out.append(record.double().hex())
+            elif conversion == "s":
+                out.append((py_spec + "s") % record.string())
+    except EOFError:
+        out.append("<truncated>")
+        return "".join(out)
+    out.append(format_string[last:])
+    return "".join(out)
+
+
+def decode(dictionary, encoded):
+    record = Record(base64.b64decode(encoded))
+    header = record.varint()
+    ident = header >> 3
+    level = header & 0x07
+    if ident >= len(dictionary):
+        return "[?????] <unknown format ID %d>" % ident
+    prefix = LEVEL_PREFIXES[level] if level < len(LEVEL_PREFIXES) else "[?????] "
+    return prefix + render(format_at(dictionary, ident), record)
+
+
+def main():
+    if len(sys.argv) == 3 and sys.argv[1] == "--dump":
+        json.dump(dump_dictionary(load_dictionary(sys.argv[2])), sys.stdout, indent=2, ensure_ascii=False)
+        print()
+        return
+    if len(sys.argv) not in (2, 3):
+        sys.exit("Usage: %s <dictionary> [log file]\n       %s --dump <dictionary>" % (sys.argv[0], sys.argv[0]))
+
+    dictionary = load_dictionary(sys.argv[1])
+    source = open(sys.argv[2], encoding="utf-8", errors="replace") if len(sys.argv) == 3 else sys.stdin
+    for line in source:
+        line = line.rstrip("\n")
+        marker = line.find(LOG_BINARY_MARKER)
+        if marker < 0:
+            print(line)
+            continue
+        fields = line[marker + len(LOG_BINARY_MARKER):].split()
+        encoded = fields[0] if fields else ""
+        try:
+            text = decode(dictionary, encoded)
+            # Crash log records cut to fit lose their last values
+            if fields[1:2] == [CRASHLOG_TRUNCATED_MARK] and not text.endswith("<truncated>"):
+                text += " <truncated>"
+            print(line[:marker] + text)
+        except (ValueError, EOFError):
+            print(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+#
+# Microvisor Weather Device Demo
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+# Simulate the OpenWeather request rate of a fleet restarted at the same
+# moment, eg. by a polite deployment, using the same device ID hashing as
+# `poll_init()` in App/poll.c. Polls run at the minimum period: forecast-
+# driven adaptation and failures are not modelled.
+#
+# Usage: poll_sim.py [--devices N] [--period S] [--restart S] [--bucket S]
+#                    [--duration S] [--mode legacy|jitter|aligned] [--warm] [--csv]
+#
+#   legacy    Every device polls at boot (the behaviour before poll.c)
+#   jitter    The first poll is spread across POLL_BOOT_SPREAD_S by device ID
+#   aligned   As jitter, then polls move to the device's wall-clock slot
+#   --warm    Devices show a cached forecast, so the first poll is spread
+#             across the whole period (see `poll_defer()`)
+
+import argparse
+import random
+
+POLL_BOOT_SPREAD_S = 60
+
+
+def device_hash(device_id):
+    value = 2166136261
+    for byte in device_id.encode("ascii"):
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def phase_ms(hash_value, span_ms):
+    return (hash_value * span_ms) >> 32
+
+
+def align_ms(hash_value, now_ms, delay_ms):
+    earliest = now_ms + delay_ms // 2 - phase_ms(hash_value, delay_ms)
+    slot = (earliest + delay_ms - 1) // delay_ms * delay_ms + phase_ms(hash_value, delay_ms)
+    return slot - now_ms
+
+
+def simulate(args):
+    rng = random.Random(args.seed)
+    period_ms = args.period * 1000
+    end_ms = args.duration * 1000
+    wall_base_ms = rng.randrange(1_700_000_000_000, 1_800_000_000_000)
+    requests = []
+    for _ in range(args.devices):
+        device_id = "UV" + "".join(rng.choice("0123456789ABCDEF") for _ in range(32))
+        hash_value = device_hash(device_id)
+
+        # Devices come back up over a short window after the restart
+        t = rng.uniform(0, args.restart * 1000)
+        if args.mode != "legacy":
+            t += phase_ms(hash_value, period_ms if args.warm else POLL_BOOT_SPREAD_S * 1000)
+        while t < end_ms:
+            requests.append(t)
+            delay = period_ms
+            if args.mode == "aligned":
+                delay = align_ms(hash_value, int(wall_base_ms + t), period_ms)
+            t += delay
+
+    buckets = [0] * ((end_ms + args.bucket * 1000 - 1) // (args.bucket * 1000))
+    for t in requests:
+        buckets[int(t // (args.bucket * 1000))] += 1
+    return buckets
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Simulate fleet OpenWeather request rates")
+    parser.add_argument("--devices", type=int, default=1000)
+    parser.add_argument("--period", type=int, default=300, help="poll period, s")
+    parser.add_argument("--restart", type=int, default=10, help="window over which devices restart, s")
+    parser.add_argument("--bucket", type=int, default=10, help="histogram bucket, s")
+    parser.add_argument("--duration", type=int, default=1800, help="simulated time, s")
+    parser.add_argument("--mode", choices=["legacy", "jitter", "aligned"], default="aligned")
+    parser.add_argument("--warm", action="store_true", help="devices hold a recent cached forecast")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--csv", action="store_true", help="print bucket start and count only")
+    args = parser.parse_args()
+
+    buckets = simulate(args)
+    if args.csv:
+        for i, count in enumerate(buckets):
+            print("%d,%d" % (i * args.bucket, count))
+        return
+
+    peak = max(buckets)
+    mean = sum(buckets) / len(buckets)
+    print("%s%s: %d devices, %d s period, peak %.1f req/s, mean %.1f req/s, peak/mean %.1f"
+          % (args.mode, " (warm)" if args.warm else "", args.devices, args.period, peak / args.bucket, mean / args.bucket, peak / mean if mean else 0))
+    for i, count in enumerate(buckets):
+        print("%6d s %6.1f req/s %s" % (i * args.bucket, count / args.bucket, "#" * round(60 * count / peak)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+#
+# Microvisor Weather Device Demo
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+# Convert a dump of the app's `trace_buffer` ring (see App/trace.h)
+# into Chrome trace JSON, viewable in chrome://tracing or Perfetto.
+#
+# Dump the ring during a remote debugging session with:
+#     dump binary value trace.bin trace_buffer
+#
+# Usage: trace_to_chrome.py trace.bin > trace.json
+
+import json
+import struct
+import sys
+
+TRACE_MAGIC = 0x5254564D
+TRACE_VERSION = 1
+TRACE_MAX_TASKS = 16
+TRACE_TASK_NAME_LEN_B = 16
+HEADER_FORMAT = "<5I"
+RECORD_FORMAT = "<IBBH"
+
+EVENT_TASK_IN = 1
+EVENT_TASK_OUT = 2
+EVENT_ISR_ENTER = 3
+EVENT_ISR_EXIT = 4
+EVENT_SPAN_BEGIN = 5
+EVENT_SPAN_END = 6
+EVENT_MARK = 7
+
+ISR_NAMES = {1: "TIM8_BRK_IRQHandler (shared NC)", 2: "TIM1_BRK_IRQHandler (network NC)"}
+SPAN_NAMES = {
+    1: "process_http_response",
+    2: "HT16K33_print",
+    3: "post_log",
+    4: "http_send_request",
+    5: "HT16K33_draw",
+    6: "new_forecast",
+}
+
+# Chrome trace process IDs: the CPU track shows which task or ISR
+# is running; the app process has one thread per task for spans
+PID_CPU = 0
+PID_APP = 1
+
+
+def read_ring(data):
+    magic, version, clock_hz, capacity, write_index = struct.unpack_from(HEADER_FORMAT, data, 0)
+    if magic != TRACE_MAGIC:
+        sys.exit("Not a trace dump (bad magic 0x%08X)" % magic)
+    if version != TRACE_VERSION:
+        sys.exit("Unsupported trace version %d" % version)
+
+    offset = struct.calcsize(HEADER_FORMAT)
+    names = {}
+    for i in range(TRACE_MAX_TASKS):
+        raw = data[offset:offset + TRACE_TASK_NAME_LEN_B].split(b"\0", 1)[0]
+        if raw:
+            names[i] = raw.decode("ascii", "replace")
+        offset += TRACE_TASK_NAME_LEN_B
+
+    record_size = struct.calcsize(RECORD_FORMAT)
+    count = min(write_index, capacity)
+    first = write_index - count
+    records = []
+    for n in range(first, write_index):
+        slot = n % capacity
+        records.append(struct.unpack_from(RECORD_FORMAT, data, offset + slot * record_size)[:3])
+    return clock_hz, names, records
+
+
+def to_chrome(clock_hz, names, records):
+    events = []
+    for tid, name in names.items():
+        events.append({"ph": "M", "name": "thread_name", "pid": PID_APP, "tid": tid, "args": {"name": name}})
+    events.append({"ph": "M", "name": "process_name", "pid": PID_CPU, "args": {"name": "CPU"}})
+    events.append({"ph": "M", "name": "process_name", "pid": PID_APP, "args": {"name": "App"}})
+
+    # Unwrap the 32-bit timestamps. Records are frequent enough,
+    # at least one per tick, that any backwards step is a single wrap
+    base = 0
+    last = None
+    current_task = 0
+    task_started = None
+    isr_started = {}
+    open_spans = {}
+    for raw, event, ident in records:
+        if last is not None and raw < last:
+            base += 1 << 32
+        last = raw
+        us = (base + raw) * 1e6 / clock_hz
+
+        if event == EVENT_TASK_IN:
+            current_task = ident
+            task_started = us
+        elif event == EVENT_TASK_OUT:
+            if task_started is not None:
+                events.append({"ph": "X", "pid": PID_CPU, "tid": 0, "ts": task_started, "dur": us - task_started,
+                               "name": names.get(ident, "task %d" % ident)})
+            task_started = None
+        elif event == EVENT_ISR_ENTER:
+            isr_started[ident] = us
+        elif event == EVENT_ISR_EXIT:
+            if ident in isr_started:
+                start = isr_started.pop(ident)
+                events.append({"ph": "X", "pid": PID_CPU, "tid": 1, "ts": start, "dur": us - start,
+                               "name": ISR_NAMES.get(ident, "ISR %d" % ident)})
+        elif event == EVENT_SPAN_BEGIN:
+            open_spans[(current_task, ident)] = open_spans.get((current_task, ident), 0) + 1
+            events.append({"ph": "B", "pid": PID_APP, "tid": current_task, "ts": us,
+                           "name": SPAN_NAMES.get(ident, "span %d" % ident)})
+        elif event == EVENT_SPAN_END:
+            # Skip ends whose begin was overwritten in the ring
+            if open_spans.get((current_task, ident), 0) == 0:
+                continue
+            open_spans[(current_task, ident)] -= 1
+            events.append({"ph": "E", "pid": PID_APP, "tid": current_task, "ts": us,
+                           "name": SPAN_NAMES.get(ident, "span %d" % ident)})
+        elif event == EVENT_MARK:
+            events.append({"ph": "i", "s": "g", "pid": PID_APP, "tid": current_task, "ts": us,
+                           "name": SPAN_NAMES.get(ident, "mark %d" % ident)})
+
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("Usage: %s <trace dump>" % sys.argv[0])
+    with open(sys.argv[1], "rb") as dump:
+        clock_hz, names, records = read_ring(dump.read())
+    json.dump(to_chrome(clock_hz, names, records), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()